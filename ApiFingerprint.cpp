@@ -0,0 +1,173 @@
+#include "ApiFingerprint.h"
+
+#include <fstream>
+#include <algorithm>
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+// seeds of the hashes used by the rows of the sketch
+static const UINT64 g_sketchSeeds[SKETCH_DEPTH] = {
+    0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0xD6E8FEB86659FD93ULL
+};
+
+static UINT64 mix(UINT64 h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+NgramCounter::NgramCounter(size_t n)
+    : m_n(n), m_filled(0), m_pos(0), m_total(0), m_topCount(0)
+{
+    if (m_n > NGRAM_MAX) m_n = NGRAM_MAX;
+    if (m_n == 0) m_n = 1;
+    ::memset(m_window, 0, sizeof(m_window));
+    ::memset(m_sketch, 0, sizeof(m_sketch));
+    ::memset(m_top, 0, sizeof(m_top));
+}
+
+UINT32 NgramCounter::increment(const UINT64 ngramHash)
+{
+    UINT32 minCount = 0;
+    for (size_t row = 0; row < SKETCH_DEPTH; row++) {
+        UINT32 &cell = m_sketch[row][mix(ngramHash ^ g_sketchSeeds[row]) % SKETCH_WIDTH];
+        cell++;
+        if (row == 0 || cell < minCount) {
+            minCount = cell;
+        }
+    }
+    return minCount;
+}
+
+UINT32 NgramCounter::estimate(const UINT64 ngramHash) const
+{
+    UINT32 minCount = 0;
+    for (size_t row = 0; row < SKETCH_DEPTH; row++) {
+        const UINT32 cell = m_sketch[row][mix(ngramHash ^ g_sketchSeeds[row]) % SKETCH_WIDTH];
+        if (row == 0 || cell < minCount) {
+            minCount = cell;
+        }
+    }
+    return minCount;
+}
+
+void NgramCounter::updateTop(const UINT64 ngramHash, const UINT32 count)
+{
+    size_t minIndex = 0;
+    for (size_t i = 0; i < m_topCount; i++) {
+        if (m_top[i].hash == ngramHash) {
+            m_top[i].count = count;
+            return;
+        }
+        if (m_top[i].count < m_top[minIndex].count) {
+            minIndex = i;
+        }
+    }
+    size_t index = m_topCount;
+    if (m_topCount == NGRAM_TOP_K) {
+        if (m_top[minIndex].count >= count) {
+            return; // not frequent enough
+        }
+        index = minIndex;
+    }
+    else {
+        m_topCount++;
+    }
+    s_ngram &ngram = m_top[index];
+    ngram.hash = ngramHash;
+    ngram.count = count;
+    // save the APIs in the order of calling
+    for (size_t i = 0; i < m_n; i++) {
+        ngram.apis[i] = m_window[(m_pos + i) % m_n];
+    }
+}
+
+void NgramCounter::addApi(const UINT64 apiHash)
+{
+    m_window[m_pos] = apiHash;
+    m_pos = (m_pos + 1) % m_n;
+    if (m_filled < m_n) {
+        m_filled++;
+        if (m_filled < m_n) return;
+    }
+    // hash the window, starting from the oldest call
+    UINT64 ngramHash = FNV_OFFSET;
+    for (size_t i = 0; i < m_n; i++) {
+        ngramHash = (ngramHash ^ m_window[(m_pos + i) % m_n]) * FNV_PRIME;
+    }
+    m_total++;
+    const UINT32 count = increment(ngramHash);
+    updateTop(ngramHash, count);
+}
+
+//---
+
+UINT64 ApiFingerprint::hashName(const std::string &name)
+{
+    UINT64 h = FNV_OFFSET;
+    for (size_t i = 0; i < name.length(); i++) {
+        h = (h ^ (UINT8)tolower(name[i])) * FNV_PRIME;
+    }
+    return h;
+}
+
+UINT64 ApiFingerprint::addApi(const ADDRINT address, const std::string &name)
+{
+    const UINT64 h = hashName(name);
+    m_apis[address] = h;
+    m_names[h] = name;
+    return h;
+}
+
+void ApiFingerprint::merge(const NgramCounter &counter)
+{
+    for (size_t row = 0; row < SKETCH_DEPTH; row++) {
+        for (size_t col = 0; col < SKETCH_WIDTH; col++) {
+            m_merged.m_sketch[row][col] += counter.m_sketch[row][col];
+        }
+    }
+    m_merged.m_total += counter.m_total;
+    for (size_t i = 0; i < counter.m_topCount; i++) {
+        m_candidates[counter.m_top[i].hash] = counter.m_top[i];
+    }
+}
+
+static bool isMoreFrequent(const s_ngram &a, const s_ngram &b)
+{
+    return a.count > b.count;
+}
+
+bool ApiFingerprint::write(const std::string &fileName) const
+{
+    std::ofstream file(fileName.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    // re-estimate the candidates using the merged sketch
+    std::vector<s_ngram> ngrams;
+    for (std::map<UINT64, s_ngram>::const_iterator itr = m_candidates.begin(); itr != m_candidates.end(); ++itr) {
+        s_ngram ngram = itr->second;
+        ngram.count = m_merged.estimate(ngram.hash);
+        ngrams.push_back(ngram);
+    }
+    std::sort(ngrams.begin(), ngrams.end(), isMoreFrequent);
+    if (ngrams.size() > NGRAM_TOP_K) {
+        ngrams.resize(NGRAM_TOP_K);
+    }
+
+    file << "# n=" << std::dec << m_merged.getN() << ";total=" << m_merged.getTotal() << std::endl;
+    for (size_t i = 0; i < ngrams.size(); i++) {
+        const s_ngram &ngram = ngrams[i];
+        file << std::hex << ngram.hash << ";" << std::dec << ngram.count << ";";
+        for (size_t k = 0; k < m_merged.getN(); k++) {
+            std::map<UINT64, std::string>::const_iterator nItr = m_names.find(ngram.apis[k]);
+            if (k > 0) file << " -> ";
+            file << ((nItr != m_names.end()) ? nItr->second : "?");
+        }
+        file << std::endl;
+    }
+    return true;
+}
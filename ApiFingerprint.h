@@ -0,0 +1,92 @@
+#pragma once
+
+#include "pin.H"
+
+#include <map>
+#include <vector>
+#include <string>
+
+#define NGRAM_MAX 8
+#define SKETCH_DEPTH 4
+#define SKETCH_WIDTH 4096
+#define NGRAM_TOP_K 64
+
+struct s_ngram {
+    UINT64 hash;
+    UINT32 count; // estimated count
+    UINT64 apis[NGRAM_MAX];
+};
+
+/**
+    Counts the n-grams of the API calls made by a single thread.
+    The counts are kept in a fixed-size count-min sketch, and the most frequent n-grams in a small top-K list,
+    so the memory used does not depend on the length of the trace.
+*/
+class NgramCounter
+{
+public:
+    NgramCounter(size_t n);
+
+    // add the next API call (given by the hash of its name) to the sequence
+    void addApi(const UINT64 apiHash);
+
+    size_t getN() const { return m_n; }
+    UINT64 getTotal() const { return m_total; }
+
+    UINT32 estimate(const UINT64 ngramHash) const;
+
+protected:
+    UINT32 increment(const UINT64 ngramHash);
+    void updateTop(const UINT64 ngramHash, const UINT32 count);
+
+    size_t m_n;
+    UINT64 m_window[NGRAM_MAX]; // the last N API calls (ring buffer)
+    size_t m_filled;
+    size_t m_pos;
+    UINT64 m_total;
+
+    UINT32 m_sketch[SKETCH_DEPTH][SKETCH_WIDTH];
+    s_ngram m_top[NGRAM_TOP_K];
+    size_t m_topCount;
+
+    friend class ApiFingerprint;
+};
+
+/**
+    The fingerprint of the traced module: the most frequent n-grams merged from all the threads.
+*/
+class ApiFingerprint
+{
+public:
+    ApiFingerprint(size_t n)
+        : m_merged(n)
+    {
+    }
+
+    static UINT64 hashName(const std::string &name);
+
+    bool hasApi(const ADDRINT address) const
+    {
+        return m_apis.find(address) != m_apis.end();
+    }
+
+    // remember the API at the given address, return the hash of its name
+    UINT64 addApi(const ADDRINT address, const std::string &name);
+
+    UINT64 getApiHash(const ADDRINT address) const
+    {
+        std::map<ADDRINT, UINT64>::const_iterator itr = m_apis.find(address);
+        return (itr != m_apis.end()) ? itr->second : 0;
+    }
+
+    void merge(const NgramCounter &counter);
+
+    bool write(const std::string &fileName) const;
+
+protected:
+    std::map<ADDRINT, UINT64> m_apis; // hashes of the APIs, by their addresses
+    std::map<UINT64, std::string> m_names; // names of the APIs, by their hashes
+
+    NgramCounter m_merged; // only the sketch is used
+    std::map<UINT64, s_ngram> m_candidates;
+};
@@ -0,0 +1,119 @@
+#include "BasicBlocks.h"
+
+#include <fstream>
+#include <algorithm>
+
+UINT16 BlocksRegistry::addModule(const ADDRINT base, const ADDRINT end, const std::string &path, bool isTraced)
+{
+    std::map<ADDRINT, UINT16>::iterator itr = m_moduleIds.find(base);
+    if (itr != m_moduleIds.end()) {
+        return itr->second;
+    }
+    s_cov_module mod;
+    mod.base = base;
+    mod.end = end;
+    mod.path = path;
+    mod.isTraced = isTraced;
+    const UINT16 id = (UINT16)m_modules.size();
+    m_modules.push_back(mod);
+    m_moduleIds[base] = id;
+    return id;
+}
+
+size_t BlocksRegistry::addBlock(const ADDRINT address, const UINT32 size, const UINT32 insCount, const UINT16 moduleId)
+{
+    // the same block can be instrumented multiple times, i.e. in different traces
+    std::map<ADDRINT, size_t>::iterator itr = m_blockIds.find(address);
+    if (itr != m_blockIds.end()) {
+        return itr->second;
+    }
+    const size_t index = m_blocks.size();
+    if (index % BLOCKS_CHUNK_SIZE == 0) {
+        UINT8* chunk = new UINT8[BLOCKS_CHUNK_SIZE];
+        ::memset(chunk, 0, BLOCKS_CHUNK_SIZE);
+        m_hitChunks.push_back(chunk);
+        if (m_useCounters) {
+            UINT64* counters = new UINT64[BLOCKS_CHUNK_SIZE];
+            ::memset(counters, 0, BLOCKS_CHUNK_SIZE * sizeof(UINT64));
+            m_counterChunks.push_back(counters);
+        }
+    }
+    s_block block;
+    block.start = address - m_modules[moduleId].base;
+    block.size = size;
+    block.insCount = insCount;
+    block.moduleId = moduleId;
+    m_blocks.push_back(block);
+    m_blockIds[address] = index;
+    return index;
+}
+
+struct CounterGreater
+{
+    CounterGreater(const BlocksRegistry &registry) : m_registry(registry) {}
+
+    bool operator()(const size_t a, const size_t b) const
+    {
+        return *m_registry.getCounterSlot(a) > *m_registry.getCounterSlot(b);
+    }
+
+    const BlocksRegistry &m_registry;
+};
+
+size_t BlocksRegistry::getHotBlocks(size_t topK, std::vector<size_t> &hotBlocks) const
+{
+    if (!m_useCounters) {
+        return 0;
+    }
+    for (size_t i = 0; i < m_blocks.size(); i++) {
+        if (*getCounterSlot(i)) {
+            hotBlocks.push_back(i);
+        }
+    }
+    if (topK > hotBlocks.size()) {
+        topK = hotBlocks.size();
+    }
+    std::partial_sort(hotBlocks.begin(), hotBlocks.begin() + topK, hotBlocks.end(), CounterGreater(*this));
+    hotBlocks.resize(topK);
+    return topK;
+}
+
+bool BlocksRegistry::writeDrcov(const std::string &fileName) const
+{
+    std::ofstream file(fileName.c_str(), std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "DRCOV VERSION: 2\n"
+        << "DRCOV FLAVOR: drcov\n"
+        << "Module Table: version 2, count " << std::dec << m_modules.size() << "\n"
+        << "Columns: id, base, end, entry, checksum, timestamp, path\n";
+
+    for (size_t i = 0; i < m_modules.size(); i++) {
+        const s_cov_module &mod = m_modules[i];
+        file << std::dec << i << ", "
+            << "0x" << std::hex << mod.base << ", "
+            << "0x" << std::hex << mod.end << ", "
+            << "0x0, 0x0, 0x0, "
+            << mod.path << "\n";
+    }
+
+    size_t covered = 0;
+    for (size_t i = 0; i < m_blocks.size(); i++) {
+        if (*getHitSlot(i)) covered++;
+    }
+    file << "BB Table: " << std::dec << covered << " bbs\n";
+
+    for (size_t i = 0; i < m_blocks.size(); i++) {
+        if (!(*getHitSlot(i))) continue;
+
+        const s_block &block = m_blocks[i];
+        // the record format: uint32 start; uint16 size; uint16 mod_id
+        const UINT32 start = (UINT32)block.start;
+        const UINT16 size = (block.size > 0xFFFF) ? 0xFFFF : (UINT16)block.size;
+        file.write((const char*)&start, sizeof(start));
+        file.write((const char*)&size, sizeof(size));
+        file.write((const char*)&block.moduleId, sizeof(block.moduleId));
+    }
+    return true;
+}
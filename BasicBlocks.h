@@ -0,0 +1,114 @@
+#pragma once
+
+#include "pin.H"
+
+#include <map>
+#include <vector>
+#include <string>
+
+#define BLOCKS_CHUNK_SIZE 0x10000
+
+struct s_cov_module {
+    ADDRINT base;
+    ADDRINT end;
+    std::string path;
+    bool isTraced; // is it the traced module (or a shellcode)
+};
+
+struct s_block {
+    ADDRINT start; // offset from the module base
+    UINT32 size;
+    UINT32 insCount;
+    UINT16 moduleId;
+};
+
+/**
+    The basic blocks of the watched code, registered at the instrumentation time.
+    Each block gets a slot in the map of the hits, and optionally an execution counter,
+    which are updated by the analysis routines.
+    The slots are allocated in chunks, so their addresses never change.
+*/
+class BlocksRegistry
+{
+public:
+    BlocksRegistry()
+        : m_useCounters(false)
+    {
+    }
+
+    ~BlocksRegistry()
+    {
+        for (size_t i = 0; i < m_hitChunks.size(); i++) {
+            delete[] m_hitChunks[i];
+        }
+        for (size_t i = 0; i < m_counterChunks.size(); i++) {
+            delete[] m_counterChunks[i];
+        }
+    }
+
+    // allocate the execution counters for the blocks: must be called before any block is added
+    void enableCounters()
+    {
+        m_useCounters = true;
+    }
+
+    /**
+        Adds the module containing the blocks, if it was not added before.
+        \return : ID of the module
+    */
+    UINT16 addModule(const ADDRINT base, const ADDRINT end, const std::string &path, bool isTraced);
+
+    /**
+        Registers the block (if it was not registered before).
+        \return : index of the block
+    */
+    size_t addBlock(const ADDRINT address, const UINT32 size, const UINT32 insCount, const UINT16 moduleId);
+
+    // the slot to be marked when the block gets executed
+    UINT8* getHitSlot(size_t index) const
+    {
+        return &m_hitChunks[index / BLOCKS_CHUNK_SIZE][index % BLOCKS_CHUNK_SIZE];
+    }
+
+    // the counter to be incremented when the block gets executed (available only if enabled)
+    UINT64* getCounterSlot(size_t index) const
+    {
+        if (!m_useCounters) {
+            return NULL;
+        }
+        return &m_counterChunks[index / BLOCKS_CHUNK_SIZE][index % BLOCKS_CHUNK_SIZE];
+    }
+
+    size_t countBlocks() const
+    {
+        return m_blocks.size();
+    }
+
+    const s_block& getBlock(size_t index) const
+    {
+        return m_blocks[index];
+    }
+
+    const s_cov_module& getModule(UINT16 moduleId) const
+    {
+        return m_modules[moduleId];
+    }
+
+    /**
+        Fills the list with the indexes of the most frequently executed blocks, sorted by the count.
+    */
+    size_t getHotBlocks(size_t topK, std::vector<size_t> &hotBlocks) const;
+
+    bool writeDrcov(const std::string &fileName) const;
+
+protected:
+
+    std::vector<s_cov_module> m_modules;
+    std::map<ADDRINT, UINT16> m_moduleIds; // by the module base
+
+    std::vector<s_block> m_blocks;
+    std::map<ADDRINT, size_t> m_blockIds; // by the block address
+    std::vector<UINT8*> m_hitChunks;
+    std::vector<UINT64*> m_counterChunks;
+    bool m_useCounters;
+};
@@ -0,0 +1,71 @@
+#include "BranchTrace.h"
+
+void BranchBuffer::writeChunk()
+{
+    if (!m_used) return;
+    m_trace.writeChunk(m_tid, m_buf, m_used);
+    m_used = 0;
+}
+
+void BranchBuffer::flush()
+{
+    flushTnt();
+    writeChunk();
+}
+
+//---
+
+bool BranchTrace::init(const std::string &fileName)
+{
+    m_fileName = fileName;
+    m_file.open(fileName.c_str(), std::ios::binary);
+    if (!m_file.is_open()) {
+        return false;
+    }
+    const UINT32 version = BT_VERSION;
+    m_file.write(BT_MAGIC, 4);
+    m_file.write((const char*)&version, sizeof(version));
+    return true;
+}
+
+void BranchTrace::writeChunk(const THREADID tid, const UINT8* buf, const size_t size)
+{
+    const UINT8 type = BT_CHUNK;
+    const UINT32 tid32 = tid;
+    const UINT32 size32 = (UINT32)size;
+
+    PIN_GetLock(&m_lock, tid + 1);
+    if (m_file.is_open()) {
+        m_file.write((const char*)&type, sizeof(type));
+        m_file.write((const char*)&tid32, sizeof(tid32));
+        m_file.write((const char*)&size32, sizeof(size32));
+        m_file.write((const char*)buf, size);
+    }
+    PIN_ReleaseLock(&m_lock);
+}
+
+void BranchTrace::addModule(const ADDRINT base, const ADDRINT end, const std::string &path)
+{
+    if (m_modules.find(base) != m_modules.end()) return;
+
+    s_bt_module &mod = m_modules[base];
+    mod.end = end;
+    mod.path = path;
+}
+
+bool BranchTrace::close()
+{
+    PIN_GetLock(&m_lock, 1);
+    m_file.close();
+    PIN_ReleaseLock(&m_lock);
+
+    const std::string modulesFile = m_fileName + ".modules";
+    std::ofstream file(modulesFile.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    for (std::map<ADDRINT, s_bt_module>::iterator itr = m_modules.begin(); itr != m_modules.end(); ++itr) {
+        file << std::hex << itr->first << ";" << itr->second.end << ";" << itr->second.path << std::endl;
+    }
+    return true;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "pin.H"
+
+#include <fstream>
+#include <map>
+#include <string>
+
+/*
+    The format of the branch trace (little endian):
+    file header: "TTBT", UINT32 version
+    chunk:       UINT8 BT_CHUNK, UINT32 thread_id, UINT32 size, followed by the packets of the given size
+    packets:
+        BT_PKT_TNT  : UINT8 bits_count, UINT64 bits - outcomes of the conditional branches (1 - taken), the oldest in the lowest bit
+        BT_PKT_TIP  : UINT64 target - the target of an indirect branch (including rets)
+        BT_PKT_SYNC : UINT64 address - the branch at which the tracing resumed, after the execution left the watched code
+    The path is to be reconstructed offline, by decoding the module image and following the packets.
+*/
+
+#define BT_MAGIC "TTBT"
+#define BT_VERSION 1
+
+#define BT_CHUNK 'C'
+#define BT_PKT_TNT 0x01
+#define BT_PKT_TIP 0x02
+#define BT_PKT_SYNC 0x03
+
+#define BT_BUFFER_SIZE 0x10000
+#define BT_PACKET_MAX 16
+
+class BranchTrace;
+
+/**
+    The packets of a single thread. Flushed to the file when the buffer gets full.
+*/
+class BranchBuffer
+{
+public:
+    BranchBuffer(BranchTrace &trace, const THREADID tid)
+        : m_trace(trace), m_tid(tid), m_used(0), m_tnt(0), m_tntCount(0), m_isOutside(true)
+    {
+    }
+
+    void addCond(const ADDRINT address, const bool isTaken)
+    {
+        syncIfNeeded(address);
+        if (isTaken) {
+            m_tnt |= (UINT64(1) << m_tntCount);
+        }
+        m_tntCount++;
+        if (m_tntCount == 64) {
+            flushTnt();
+        }
+    }
+
+    void addTarget(const ADDRINT address, const ADDRINT target, const bool isTargetInside)
+    {
+        syncIfNeeded(address);
+        flushTnt();
+        putPacket(BT_PKT_TIP, target);
+        if (!isTargetInside) {
+            m_isOutside = true;
+        }
+    }
+
+    // the execution goes out of the watched code by a direct branch
+    void leave()
+    {
+        m_isOutside = true;
+    }
+
+    // save all the pending packets
+    void flush();
+
+protected:
+    void syncIfNeeded(const ADDRINT address)
+    {
+        if (!m_isOutside) return;
+        flushTnt();
+        putPacket(BT_PKT_SYNC, address);
+        m_isOutside = false;
+    }
+
+    void flushTnt()
+    {
+        if (!m_tntCount) return;
+        reserve();
+        m_buf[m_used++] = BT_PKT_TNT;
+        m_buf[m_used++] = m_tntCount;
+        ::memcpy(&m_buf[m_used], &m_tnt, sizeof(m_tnt));
+        m_used += sizeof(m_tnt);
+        m_tnt = 0;
+        m_tntCount = 0;
+    }
+
+    void putPacket(const UINT8 type, const ADDRINT address)
+    {
+        reserve();
+        const UINT64 val = address;
+        m_buf[m_used++] = type;
+        ::memcpy(&m_buf[m_used], &val, sizeof(val));
+        m_used += sizeof(val);
+    }
+
+    void reserve()
+    {
+        if (m_used + BT_PACKET_MAX > BT_BUFFER_SIZE) {
+            writeChunk();
+        }
+    }
+
+    void writeChunk();
+
+    BranchTrace &m_trace;
+    THREADID m_tid;
+
+    UINT8 m_buf[BT_BUFFER_SIZE];
+    size_t m_used;
+
+    UINT64 m_tnt;
+    UINT8 m_tntCount;
+    bool m_isOutside;
+};
+
+/**
+    The output file of the branch trace, shared by all the threads.
+*/
+class BranchTrace
+{
+public:
+    BranchTrace()
+    {
+        PIN_InitLock(&m_lock);
+    }
+
+    bool init(const std::string &fileName);
+
+    void writeChunk(const THREADID tid, const UINT8* buf, const size_t size);
+
+    // remember the module in which the traced code is, needed to decode the trace
+    void addModule(const ADDRINT base, const ADDRINT end, const std::string &path);
+
+    // write the list of the modules, and close the trace
+    bool close();
+
+protected:
+    struct s_bt_module {
+        ADDRINT end;
+        std::string path;
+    };
+
+    PIN_LOCK m_lock;
+    std::string m_fileName;
+    std::ofstream m_file;
+    std::map<ADDRINT, s_bt_module> m_modules;
+};
@@ -0,0 +1,126 @@
+#include "CallGraph.h"
+
+#include <fstream>
+
+void EdgeTable::grow()
+{
+    const size_t newCapacity = m_capacity * 2;
+    s_edge* newSlots = new s_edge[newCapacity];
+    ::memset(newSlots, 0, newCapacity * sizeof(s_edge));
+
+    for (size_t i = 0; i < m_capacity; i++) {
+        const s_edge &edge = m_slots[i];
+        if (edge.count == 0) continue;
+        *find(newSlots, newCapacity, edge.from, edge.to) = edge;
+    }
+    delete[] m_slots;
+    m_slots = newSlots;
+    m_capacity = newCapacity;
+}
+
+//---
+
+static std::string escapeStr(const std::string &str)
+{
+    std::string out;
+    for (size_t i = 0; i < str.length(); i++) {
+        const char c = str[i];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+void CallGraph::addNode(const ADDRINT key, const std::string &name, t_node_type type)
+{
+    if (hasNode(key)) return;
+
+    s_node &node = m_nodes[key];
+    node.id = m_nodes.size() - 1;
+    node.name = name;
+    node.type = type;
+}
+
+void CallGraph::merge(const EdgeTable &edges)
+{
+    for (size_t i = 0; i < edges.capacity(); i++) {
+        const s_edge &edge = edges.at(i);
+        if (edge.count == 0) continue;
+        m_edges[std::make_pair(edge.from, edge.to)] += edge.count;
+    }
+}
+
+const CallGraph::s_node* CallGraph::getNode(const ADDRINT key) const
+{
+    std::map<ADDRINT, s_node>::const_iterator itr = m_nodes.find(key);
+    if (itr == m_nodes.end()) {
+        return NULL;
+    }
+    return &itr->second;
+}
+
+bool CallGraph::writeDot(const std::string &fileName) const
+{
+    static const char* shapes[NODE_TYPES_COUNT] = { "box", "ellipse", "diamond" };
+
+    std::ofstream file(fileName.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "digraph calls {" << std::endl;
+    for (std::map<ADDRINT, s_node>::const_iterator itr = m_nodes.begin(); itr != m_nodes.end(); ++itr) {
+        const s_node &node = itr->second;
+        file << "  n" << std::dec << node.id
+            << " [label=\"" << escapeStr(node.name) << "\" shape=" << shapes[node.type] << "];"
+            << std::endl;
+    }
+    std::map<std::pair<ADDRINT, ADDRINT>, UINT64>::const_iterator eItr;
+    for (eItr = m_edges.begin(); eItr != m_edges.end(); ++eItr) {
+        const s_node* from = getNode(eItr->first.first);
+        const s_node* to = getNode(eItr->first.second);
+        if (!from || !to) continue;
+        file << "  n" << std::dec << from->id << " -> n" << to->id
+            << " [label=\"" << eItr->second << "\"];"
+            << std::endl;
+    }
+    file << "}" << std::endl;
+    return true;
+}
+
+bool CallGraph::writeJson(const std::string &fileName) const
+{
+    static const char* types[NODE_TYPES_COUNT] = { "section", "api", "shellcode" };
+
+    std::ofstream file(fileName.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "{\n  \"nodes\": [";
+    bool isFirst = true;
+    for (std::map<ADDRINT, s_node>::const_iterator itr = m_nodes.begin(); itr != m_nodes.end(); ++itr) {
+        const s_node &node = itr->second;
+        file << (isFirst ? "\n" : ",\n")
+            << "    {\"id\": " << std::dec << node.id
+            << ", \"name\": \"" << escapeStr(node.name) << "\""
+            << ", \"type\": \"" << types[node.type] << "\""
+            << ", \"address\": \"0x" << std::hex << itr->first << "\"}";
+        isFirst = false;
+    }
+    file << "\n  ],\n  \"edges\": [";
+    isFirst = true;
+    std::map<std::pair<ADDRINT, ADDRINT>, UINT64>::const_iterator eItr;
+    for (eItr = m_edges.begin(); eItr != m_edges.end(); ++eItr) {
+        const s_node* from = getNode(eItr->first.first);
+        const s_node* to = getNode(eItr->first.second);
+        if (!from || !to) continue;
+        file << (isFirst ? "\n" : ",\n")
+            << "    {\"from\": " << std::dec << from->id
+            << ", \"to\": " << to->id
+            << ", \"count\": " << eItr->second << "}";
+        isFirst = false;
+    }
+    file << "\n  ]\n}" << std::endl;
+    return true;
+}
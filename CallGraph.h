@@ -0,0 +1,123 @@
+#pragma once
+
+#include "pin.H"
+
+#include <map>
+#include <string>
+
+#define EDGES_INIT_CAPACITY 256
+
+typedef enum {
+    NODE_SECTION = 0, // a section of the traced module
+    NODE_API,         // a function of another module
+    NODE_SHELLCODE,   // a memory page that does not belong to any module
+    NODE_TYPES_COUNT
+} t_node_type;
+
+struct s_edge {
+    ADDRINT from;
+    ADDRINT to;
+    UINT64 count; // 0 marks an empty slot
+};
+
+/**
+    A compact hash table of the edges, filled by a single thread.
+    Uses open addressing, so that incrementing the count of a known edge does not allocate.
+*/
+class EdgeTable
+{
+public:
+    EdgeTable()
+        : m_size(0), m_capacity(EDGES_INIT_CAPACITY)
+    {
+        m_slots = new s_edge[m_capacity];
+        ::memset(m_slots, 0, m_capacity * sizeof(s_edge));
+    }
+
+    ~EdgeTable()
+    {
+        delete[] m_slots;
+    }
+
+    void add(const ADDRINT from, const ADDRINT to)
+    {
+        if ((m_size + 1) * 2 > m_capacity) {
+            grow();
+        }
+        s_edge* slot = find(m_slots, m_capacity, from, to);
+        if (slot->count == 0) {
+            slot->from = from;
+            slot->to = to;
+            m_size++;
+        }
+        slot->count++;
+    }
+
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    // get the slot by the index: check the count to know if it is filled
+    const s_edge& at(size_t index) const
+    {
+        return m_slots[index];
+    }
+
+protected:
+    static UINT64 hash(const ADDRINT from, const ADDRINT to)
+    {
+        UINT64 h = UINT64(from) * 0x9E3779B97F4A7C15ULL;
+        h ^= UINT64(to) + 0x7F4A7C159E3779B9ULL + (h << 6) + (h >> 2);
+        return h ^ (h >> 29);
+    }
+
+    static s_edge* find(s_edge* slots, const size_t capacity, const ADDRINT from, const ADDRINT to)
+    {
+        size_t index = hash(from, to) & (capacity - 1);
+        while (slots[index].count != 0
+            && (slots[index].from != from || slots[index].to != to))
+        {
+            index = (index + 1) & (capacity - 1);
+        }
+        return &slots[index];
+    }
+
+    void grow();
+
+    s_edge* m_slots;
+    size_t m_size;
+    size_t m_capacity; // always a power of 2
+};
+
+/**
+    The graph of the calls: from the sections of the traced module (or the shellcodes) to the called APIs (or shellcodes).
+    Merged from the per-thread tables, written once at exit.
+*/
+class CallGraph
+{
+public:
+    bool hasNode(const ADDRINT key) const
+    {
+        return m_nodes.find(key) != m_nodes.end();
+    }
+
+    void addNode(const ADDRINT key, const std::string &name, t_node_type type);
+
+    void merge(const EdgeTable &edges);
+
+    bool writeDot(const std::string &fileName) const;
+    bool writeJson(const std::string &fileName) const;
+
+protected:
+    struct s_node {
+        size_t id;
+        std::string name;
+        t_node_type type;
+    };
+
+    const s_node* getNode(const ADDRINT key) const;
+
+    std::map<ADDRINT, s_node> m_nodes;
+    std::map<std::pair<ADDRINT, ADDRINT>, UINT64> m_edges;
+};
@@ -0,0 +1,103 @@
+#include "EventBaseline.h"
+
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <sstream>
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+UINT64 EventBaseline::hashText(UINT64 hash, const std::string &text)
+{
+    for (size_t i = 0; i < text.length(); i++) {
+        hash ^= (UINT8)text[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+bool EventBaseline::load(const std::string &fileName)
+{
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    char magic[4] = { 0 };
+    UINT32 version = 0;
+    UINT32 flags = 0;
+    UINT64 count = 0;
+    file.read(magic, sizeof(magic));
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&flags, sizeof(flags));
+    file.read((char*)&count, sizeof(count));
+    if (!file.good() || ::memcmp(magic, BASELINE_MAGIC, sizeof(magic)) != 0 || version != BASELINE_VERSION) {
+        return false;
+    }
+    // the events must be hashed in the same way as in the reference run
+    m_flags = flags;
+    m_hashes.resize((size_t)count);
+    if (count) {
+        file.read((char*)&m_hashes[0], (std::streamsize)(count * sizeof(UINT64)));
+    }
+    if (!file.good()) {
+        m_hashes.clear();
+        return false;
+    }
+    // the lookup relies on the order
+    std::sort(m_hashes.begin(), m_hashes.end());
+    return true;
+}
+
+bool EventBaseline::save(const std::string &fileName) const
+{
+    std::ofstream file(fileName.c_str(), std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    const UINT32 version = BASELINE_VERSION;
+    const UINT64 count = m_collected.size();
+    file.write(BASELINE_MAGIC, 4);
+    file.write((const char*)&version, sizeof(version));
+    file.write((const char*)&m_flags, sizeof(m_flags));
+    file.write((const char*)&count, sizeof(count));
+    // std::set is already sorted
+    for (std::set<UINT64>::const_iterator itr = m_collected.begin(); itr != m_collected.end(); ++itr) {
+        const UINT64 hash = *itr;
+        file.write((const char*)&hash, sizeof(hash));
+    }
+    return file.good();
+}
+
+bool EventBaseline::check(const UINT64 hash)
+{
+    if (m_isCollecting) {
+        m_collected.insert(hash);
+    }
+    if (std::binary_search(m_hashes.begin(), m_hashes.end(), hash)) {
+        m_suppressed++;
+        return false;
+    }
+    return true;
+}
+
+bool EventBaseline::checkEvent(const THREADID tid, const std::string &caller, const ADDRINT rva, const std::string &event)
+{
+    UINT64 hash = hashText(FNV_OFFSET, caller);
+    if (isWithRva()) {
+        std::stringstream ss;
+        ss << "+" << std::hex << rva;
+        hash = hashText(hash, ss.str());
+    }
+    hash = hashText(hash, "\n");
+    hash = hashText(hash, event);
+    m_lastEvents[tid] = hash;
+    return check(hash);
+}
+
+bool EventBaseline::checkArgs(const THREADID tid, const std::string &args)
+{
+    std::map<THREADID, UINT64>::const_iterator found = m_lastEvents.find(tid);
+    const UINT64 callHash = (found != m_lastEvents.end()) ? found->second : FNV_OFFSET;
+    return check(hashText(callHash, args));
+}
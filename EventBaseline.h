@@ -0,0 +1,90 @@
+#pragma once
+
+#include "pin.H"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#define BASELINE_MAGIC "TTBL"
+#define BASELINE_VERSION 3
+
+#define BASELINE_FLAG_RVA 1
+
+/**
+    Hashes of the events seen in a reference run.
+    Each event is hashed as an edge: the short name of the calling module along with the event (i.e. the short name of the called module
+    and the function), without the paths and the addresses, so that the same noise (i.e. of the CRT) is matched also in a repacked sample.
+    Optionally (BASELINE_FLAG_RVA), the edge includes also the section and the RVA of the caller, to match only the same call site.
+    The arguments are hashed along with the call that they belong to.
+    File format: "TTBL", UINT32 version, UINT32 flags, UINT64 count, followed by the sorted UINT64 hashes.
+*/
+class EventBaseline
+{
+public:
+    EventBaseline()
+        : m_flags(0), m_isCollecting(false), m_suppressed(0)
+    {
+    }
+
+    // load the hashes of the events that should not be logged (along with the flags with which they were made)
+    bool load(const std::string &fileName);
+
+    // match only the events issued from the same call site (set by the loaded baseline)
+    void setWithRva(const bool isEnabled)
+    {
+        if (isEnabled) m_flags |= BASELINE_FLAG_RVA;
+        else m_flags &= ~BASELINE_FLAG_RVA;
+    }
+
+    bool isWithRva() const
+    {
+        return (m_flags & BASELINE_FLAG_RVA) != 0;
+    }
+
+    // collect the hashes of all the events, to be saved as a new baseline
+    void enableCollecting()
+    {
+        m_isCollecting = true;
+    }
+
+    bool save(const std::string &fileName) const;
+
+    /**
+        Checks the formatted event against the baseline (and collects its hash, if requested).
+        \param caller : the name of the module from which the event was issued (with the section, if isWithRva)
+        \param rva : the RVA of the caller, hashed only if isWithRva
+        \param event : the identity of the event, without the paths and the addresses
+        \return : true if the event should be logged, false if it was already seen in the reference run
+    */
+    bool checkEvent(const THREADID tid, const std::string &caller, const ADDRINT rva, const std::string &event);
+
+    /**
+        Checks the arguments of the call, along with the last event checked in this thread (the call that they belong to).
+        \return : true if the arguments should be logged, false if the same call with the same arguments was seen in the reference run
+    */
+    bool checkArgs(const THREADID tid, const std::string &args);
+
+    size_t countLoaded() const
+    {
+        return m_hashes.size();
+    }
+
+    size_t countSuppressed() const
+    {
+        return m_suppressed;
+    }
+
+protected:
+    static UINT64 hashText(UINT64 hash, const std::string &text);
+
+    bool check(const UINT64 hash);
+
+    std::vector<UINT64> m_hashes; // sorted
+    std::map<THREADID, UINT64> m_lastEvents; // the hash of the last event checked in each thread
+    std::set<UINT64> m_collected;
+    UINT32 m_flags;
+    bool m_isCollecting;
+    size_t m_suppressed;
+};
@@ -0,0 +1,88 @@
+#include "FlightRecorder.h"
+
+#include <algorithm>
+#include <cstring>
+
+bool FlightRing::add(const UINT64 seq, const std::string &line)
+{
+    if (m_records.empty()) return false;
+
+    s_flight_record &rec = m_records[m_next];
+    rec.seq = seq;
+    if (line.length() <= FLIGHT_TEXT_MAX) {
+        rec.length = (UINT32)line.length();
+        ::memcpy(rec.text, line.c_str(), rec.length);
+    }
+    else {
+        const size_t markLen = sizeof(FLIGHT_TRUNCATED_MARK) - 1;
+        const size_t keptLen = FLIGHT_TEXT_MAX - markLen;
+        ::memcpy(rec.text, line.c_str(), keptLen);
+        ::memcpy(rec.text + keptLen, FLIGHT_TRUNCATED_MARK, markLen);
+        rec.length = FLIGHT_TEXT_MAX;
+    }
+
+    m_next = (m_next + 1) % m_records.size();
+    if (m_count < m_records.size()) {
+        m_count++;
+        return false;
+    }
+    return true;
+}
+
+//---
+
+FlightRecorder::~FlightRecorder()
+{
+    for (std::map<THREADID, FlightRing*>::iterator itr = m_rings.begin(); itr != m_rings.end(); ++itr) {
+        delete itr->second;
+    }
+    m_rings.clear();
+}
+
+void FlightRecorder::record(const THREADID tid, const std::string &line)
+{
+    FlightRing* ring = NULL;
+    std::map<THREADID, FlightRing*>::iterator found = m_rings.find(tid);
+    if (found != m_rings.end()) {
+        ring = found->second;
+    }
+    else {
+        ring = new FlightRing(m_recordsPerThread);
+        m_rings[tid] = ring;
+    }
+    if (ring->add(m_seq++, line)) {
+        m_dropped++;
+    }
+    else {
+        m_held++;
+    }
+}
+
+bool compareSeq(const s_flight_record* a, const s_flight_record* b)
+{
+    return a->seq < b->seq;
+}
+
+size_t FlightRecorder::dump(std::ostream &out, const std::string &reason)
+{
+    std::vector<const s_flight_record*> records;
+    for (std::map<THREADID, FlightRing*>::iterator itr = m_rings.begin(); itr != m_rings.end(); ++itr) {
+        const FlightRing* ring = itr->second;
+        for (size_t i = 0; i < ring->count(); i++) {
+            records.push_back(&ring->at(i));
+        }
+    }
+    std::sort(records.begin(), records.end(), compareSeq);
+
+    out << "# flight recorder dump: " << reason << " [records=" << std::dec << records.size() << "]" << std::endl;
+    for (size_t i = 0; i < records.size(); i++) {
+        out.write(records[i]->text, records[i]->length);
+    }
+    out.flush();
+
+    for (std::map<THREADID, FlightRing*>::iterator itr = m_rings.begin(); itr != m_rings.end(); ++itr) {
+        itr->second->clear();
+    }
+    m_held = 0;
+    return records.size();
+}
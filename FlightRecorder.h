@@ -0,0 +1,119 @@
+#pragma once
+
+#include "pin.H"
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#define FLIGHT_TEXT_MAX 236
+#define FLIGHT_TRUNCATED_MARK " [truncated]\n"
+
+/**
+    The record keeps the line already formatted by the TraceLog, in a fixed-size slot, so that the memory of the ring is allocated only once.
+    The longer lines (i.e. the dumps of the arguments) are cut, and end with FLIGHT_TRUNCATED_MARK.
+*/
+struct s_flight_record {
+    UINT64 seq; // global order of the records, across all the threads
+    UINT32 length;
+    char text[FLIGHT_TEXT_MAX];
+};
+
+/**
+    Fixed-size ring of the most recent records of a single thread.
+*/
+class FlightRing
+{
+public:
+    FlightRing(const size_t capacity)
+        : m_records(capacity), m_next(0), m_count(0)
+    {
+    }
+
+    // \return : true if the oldest record was overwritten
+    bool add(const UINT64 seq, const std::string &line);
+
+    size_t count() const
+    {
+        return m_count;
+    }
+
+    // get the record by its index, counting from the oldest one
+    const s_flight_record& at(const size_t index) const
+    {
+        const size_t first = (m_next + m_records.size() - m_count) % m_records.size();
+        return m_records[(first + index) % m_records.size()];
+    }
+
+    void clear()
+    {
+        m_count = 0;
+    }
+
+protected:
+    std::vector<s_flight_record> m_records;
+    size_t m_next;
+    size_t m_count;
+};
+
+/**
+    Keeps the last records of each thread in memory, instead of writing them to the file.
+    The records are written only when the dump is requested (by a trigger, or at exit).
+    Not synchronized: the caller must hold the client lock.
+*/
+class FlightRecorder
+{
+public:
+    FlightRecorder(const size_t recordsPerThread)
+        : m_recordsPerThread(recordsPerThread), m_seq(0), m_held(0), m_dropped(0)
+    {
+    }
+
+    ~FlightRecorder();
+
+    void record(const THREADID tid, const std::string &line);
+
+    // the function, a call to which triggers the dump
+    void addTrigger(const std::string &funcName)
+    {
+        m_triggers.insert(funcName);
+    }
+
+    bool isTrigger(const std::string &funcName) const
+    {
+        return m_triggers.find(funcName) != m_triggers.end();
+    }
+
+    // the records kept in memory, waiting for the dump
+    size_t countHeld() const
+    {
+        return m_held;
+    }
+
+    size_t capacity() const
+    {
+        return m_recordsPerThread * m_rings.size();
+    }
+
+    // the records overwritten by the newer ones, before they could be dumped
+    UINT64 countDropped() const
+    {
+        return m_dropped;
+    }
+
+    /**
+        Writes the records of all the threads, in the order in which they were recorded, and clears the rings.
+        \return : the number of the records written
+    */
+    size_t dump(std::ostream &out, const std::string &reason);
+
+protected:
+    size_t m_recordsPerThread;
+    UINT64 m_seq;
+    size_t m_held;
+    UINT64 m_dropped;
+    std::map<THREADID, FlightRing*> m_rings;
+    std::set<std::string> m_triggers;
+};
@@ -29,9 +29,54 @@ bool WFuncInfo::load(const std::string &sline, char delimiter)
         ss << std::dec << args[2];
         ss >> this->paramCount;
     }
+    if (args.size() > 3) {
+        loadCaptureSpec(args[3]);
+    }
     return true;
 }
 
+bool WFuncInfo::loadCaptureSpec(const std::string &spec)
+{
+    std::vector<std::string> items;
+    split_list(spec, ',', items);
+    for (size_t i = 0; i < items.size(); i++) {
+        const std::string &item = items[i];
+        if (item == "r") {
+            this->captureRet = true;
+            continue;
+        }
+        if (item.length() < 2 || item[0] != 'o') {
+            continue; // unknown item
+        }
+        OutParam param;
+        const size_t sep = item.find(':');
+        {
+            std::stringstream ss;
+            ss << std::dec << item.substr(1, sep - 1);
+            ss >> param.argIdx;
+        }
+        if (sep != std::string::npos && sep + 1 < item.length()) {
+            std::string sizeStr = item.substr(sep + 1);
+            if (sizeStr[0] == '*') {
+                param.sizeType = OUT_SIZE_ARG_PTR;
+                sizeStr = sizeStr.substr(1);
+            }
+            else if (sizeStr[0] == '#') {
+                param.sizeType = OUT_SIZE_ARG_VAL;
+                sizeStr = sizeStr.substr(1);
+            }
+            else {
+                param.sizeType = OUT_SIZE_FIXED;
+            }
+            std::stringstream ss;
+            ss << std::dec << sizeStr;
+            ss >> param.size;
+        }
+        this->outParams.push_back(param);
+    }
+    return isPostCapture();
+}
+
 bool WFuncInfo::update(const WFuncInfo &func_info)
 {
     bool isUpdated = false;
@@ -39,6 +84,14 @@ bool WFuncInfo::update(const WFuncInfo &func_info)
         this->paramCount = func_info.paramCount;
         isUpdated = true;
     }
+    if (!this->captureRet && func_info.captureRet) {
+        this->captureRet = true;
+        isUpdated = true;
+    }
+    if (this->outParams.size() == 0 && func_info.outParams.size() > 0) {
+        this->outParams = func_info.outParams;
+        isUpdated = true;
+    }
     return isUpdated;
 }
 
@@ -7,10 +7,28 @@
 #include <cstdio>
 #include <vector>
 
+typedef enum {
+    OUT_SIZE_DEFAULT = 0, // a single value of the pointer size
+    OUT_SIZE_FIXED,       // the size in bytes is given explicitly, i.e. "o1:16"
+    OUT_SIZE_ARG_PTR,     // the size is stored under the pointer passed in another argument, i.e. "o1:*3"
+    OUT_SIZE_ARG_VAL      // the size is passed as a value of another argument, i.e. "o1:#2"
+} t_out_size;
+
+struct OutParam
+{
+    OutParam() : argIdx(0), sizeType(OUT_SIZE_DEFAULT), size(0)
+    {
+    }
+
+    size_t argIdx;
+    t_out_size sizeType;
+    size_t size; // size in bytes, or the index of the argument defining the size
+};
+
 class WFuncInfo 
 {
 public:
-    WFuncInfo() : paramCount(0)
+    WFuncInfo() : paramCount(0), captureRet(false)
     {
     }
 
@@ -19,12 +37,32 @@ public:
         this->dllName = a.dllName;
         this->funcName = a.funcName;
         this->paramCount = a.paramCount;
+        this->captureRet = a.captureRet;
+        this->outParams = a.outParams;
     }
 
     bool load(const std::string &line, char delimiter);
 
+    /**
+        Loads the list of the values to be captured after the function returns,
+        in a format: [r][,o<arg_idx>[:<size>|:*<size_arg_idx>|:#<size_arg_idx>]]...
+        \return : true if at least one value is to be captured
+    */
+    bool loadCaptureSpec(const std::string &spec);
+
+    bool isPostCapture() const
+    {
+        return captureRet || outParams.size() > 0;
+    }
+
     bool update(const WFuncInfo &func_info);
 
+    // the name to be logged: <dll>.<function>, where the DLL name is given as in the watch list (without the extension)
+    std::string getName() const
+    {
+        return dllName + "." + funcName;
+    }
+
     bool isValid() const
     {
         if (dllName.length() > 0 && funcName.length() > 0) {
@@ -36,6 +74,8 @@ public:
     std::string dllName;
     std::string funcName;
     size_t paramCount;
+    bool captureRet;
+    std::vector<OutParam> outParams;
 };
 
 class FuncWatchList {
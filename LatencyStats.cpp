@@ -0,0 +1,67 @@
+#include "LatencyStats.h"
+
+#include <fstream>
+
+#define DELIMITER ';'
+
+void LatencyStats::merge(const LatencyStats &other)
+{
+    if (other.m_hists.size() > m_hists.size()) {
+        return;
+    }
+    for (size_t i = 0; i < other.m_hists.size(); i++) {
+        const s_latency_hist &src = other.m_hists[i];
+        s_latency_hist &dst = m_hists[i];
+        dst.count += src.count;
+        dst.total += src.total;
+        if (src.max > dst.max) {
+            dst.max = src.max;
+        }
+        for (size_t b = 0; b < LATENCY_BUCKETS; b++) {
+            dst.buckets[b] += src.buckets[b];
+        }
+    }
+}
+
+UINT64 LatencyStats::percentile(const s_latency_hist &hist, const size_t percent) const
+{
+    const UINT64 threshold = (hist.count * percent + 99) / 100;
+    UINT64 sum = 0;
+    for (size_t b = 0; b < LATENCY_BUCKETS; b++) {
+        sum += hist.buckets[b];
+        if (sum >= threshold) {
+            const UINT64 upper = (b + 1 < LATENCY_BUCKETS) ? (UINT64(1) << (b + 1)) : hist.max;
+            return (upper < hist.max) ? upper : hist.max;
+        }
+    }
+    return hist.max;
+}
+
+bool LatencyStats::writeReport(const std::string &fileName, const FuncWatchList &watch) const
+{
+    std::ofstream file(fileName.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "function" << DELIMITER << "count" << DELIMITER << "total" << DELIMITER
+        << "p50" << DELIMITER << "p90" << DELIMITER << "p99" << DELIMITER << "max"
+        << std::endl;
+
+    for (size_t i = 0; i < m_hists.size() && i < watch.funcs.size(); i++) {
+        const s_latency_hist &hist = m_hists[i];
+        if (!hist.count) continue;
+
+        const WFuncInfo &info = watch.funcs[i];
+        file << std::dec
+            << info.dllName << "." << info.funcName << DELIMITER
+            << hist.count << DELIMITER
+            << hist.total << DELIMITER
+            << percentile(hist, 50) << DELIMITER
+            << percentile(hist, 90) << DELIMITER
+            << percentile(hist, 99) << DELIMITER
+            << hist.max
+            << std::endl;
+    }
+    file.close();
+    return true;
+}
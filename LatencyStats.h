@@ -0,0 +1,64 @@
+#pragma once
+
+#include "pin.H"
+
+#include <vector>
+#include "FuncWatch.h"
+
+#define LATENCY_BUCKETS 64
+
+// log-scale histogram of the durations (in TSC ticks) of a single function
+struct s_latency_hist {
+    UINT64 count;
+    UINT64 total;
+    UINT64 max;
+    UINT64 buckets[LATENCY_BUCKETS]; // bucket N holds the durations in range: [2^N, 2^(N+1))
+};
+
+class LatencyStats
+{
+public:
+    LatencyStats(size_t funcsCount)
+        : m_hists(funcsCount)
+    {
+        for (size_t i = 0; i < m_hists.size(); i++) {
+            ::memset(&m_hists[i], 0, sizeof(s_latency_hist));
+        }
+    }
+
+    void add(const UINT32 funcId, const UINT64 ticks)
+    {
+        if (funcId >= m_hists.size()) return;
+
+        s_latency_hist &hist = m_hists[funcId];
+        hist.count++;
+        hist.total += ticks;
+        if (ticks > hist.max) {
+            hist.max = ticks;
+        }
+        hist.buckets[bucketOf(ticks)]++;
+    }
+
+    void merge(const LatencyStats &other);
+
+    /**
+        Writes the summary for each of the called functions: count, percentiles, and the total time.
+    */
+    bool writeReport(const std::string &fileName, const FuncWatchList &watch) const;
+
+protected:
+    static size_t bucketOf(UINT64 ticks)
+    {
+        size_t bucket = 0;
+        while (ticks > 1 && bucket < (LATENCY_BUCKETS - 1)) {
+            ticks >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    // get the estimated value (the upper bound of the bucket) below which the given percent of the durations falls
+    UINT64 percentile(const s_latency_hist &hist, const size_t percent) const;
+
+    std::vector<s_latency_hist> m_hists;
+};
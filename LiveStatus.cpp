@@ -0,0 +1,69 @@
+#include "LiveStatus.h"
+
+#include <vector>
+
+bool LiveStatus::init(const std::string &fileName)
+{
+    NATIVE_FD fd;
+    OS_RETURN_CODE ret = OS_OpenFD(fileName.c_str(),
+        OS_FILE_OPEN_TYPE_CREATE | OS_FILE_OPEN_TYPE_TRUNCATE | OS_FILE_OPEN_TYPE_READ | OS_FILE_OPEN_TYPE_WRITE,
+        OS_FILE_PERMISSION_TYPE_READ | OS_FILE_PERMISSION_TYPE_WRITE,
+        &fd);
+    if (!OS_RETURN_CODE_IS_SUCCESS(ret)) {
+        return false;
+    }
+    // the file must have its full size before it is mapped
+    std::vector<char> zeros(sizeof(s_live_status), 0);
+    USIZE written = zeros.size();
+    ret = OS_WriteFD(fd, &zeros[0], &written);
+
+    VOID* mapped = NULL;
+    if (OS_RETURN_CODE_IS_SUCCESS(ret) && written == zeros.size()) {
+        ret = OS_MapFileToMemory(NATIVE_PID_CURRENT, OS_PAGE_PROTECTION_TYPE_READ | OS_PAGE_PROTECTION_TYPE_WRITE,
+            sizeof(s_live_status), OS_MEMORY_FLAGS_SHARED, fd, 0, &mapped);
+        if (!OS_RETURN_CODE_IS_SUCCESS(ret)) {
+            mapped = NULL;
+        }
+    }
+    OS_CloseFD(fd);
+    if (!mapped) {
+        return false;
+    }
+    m_status = static_cast<volatile s_live_status*>(mapped);
+    volatile s_live_header &h = m_status->header;
+    h.version = LIVE_STATUS_VERSION;
+    h.pid = (UINT32)PIN_GetPid();
+    h.threadsMax = LIVE_THREADS_MAX;
+    // the reader accepts the file only when the header is complete
+    h.magic = LIVE_STATUS_MAGIC;
+    return true;
+}
+
+void LiveStatus::setThreadAlive(const THREADID tid, const bool isAlive)
+{
+    volatile s_live_thread* t = thread(tid);
+    if (!t) return;
+    t->tid = tid;
+    t->isAlive = isAlive ? 1 : 0;
+}
+
+void LiveStatus::setSection(const THREADID tid, const std::string &name)
+{
+    volatile s_live_thread* t = thread(tid);
+    if (!t) return;
+    beginUpdate(t->sequence);
+    size_t i = 0;
+    for (; i < name.length() && i < (LIVE_SECTION_MAX - 1); i++) {
+        t->section[i] = name[i];
+    }
+    t->section[i] = '\0';
+    endUpdate(t->sequence);
+}
+
+void LiveStatus::close()
+{
+    if (!m_status) return;
+    m_status->header.isFinished = 1;
+    OS_FreeMemory(NATIVE_PID_CURRENT, const_cast<s_live_status*>(m_status), sizeof(s_live_status));
+    m_status = NULL;
+}
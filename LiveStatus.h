@@ -0,0 +1,165 @@
+#pragma once
+
+#include "pin.H"
+
+#include <string>
+
+#define LIVE_STATUS_MAGIC 0x534c5454 // "TTLS"
+#define LIVE_STATUS_VERSION 2
+
+#define LIVE_THREADS_MAX 64
+#define LIVE_SECTION_MAX 36
+
+/*
+    The layout of the status file, read by the other processes (see: install_linux/live_status.py).
+    All the fields are little-endian and naturally aligned: keep the reader in sync when changing them.
+*/
+
+struct s_live_thread {
+    UINT32 tid;
+    UINT32 isAlive;
+    UINT64 events; // logged by this thread
+    UINT32 pendingCalls; // the watched calls waiting for their return
+    UINT32 pendingMax;
+    UINT32 sequence; // guards the other fields of the thread (see: LiveStatus)
+    char section[LIVE_SECTION_MAX]; // the current section of the traced module, NULL-terminated
+}; // 64 bytes
+
+struct s_live_header {
+    UINT32 magic;
+    UINT32 version;
+    UINT32 pid;
+    UINT32 threadsMax;
+    UINT64 eventsLogged;
+    UINT64 eventsFiltered; // skipped by the baseline
+    UINT64 eventsDropped; // overwritten in the flight recorder, or not followed to their return
+    UINT64 bytesWritten;
+    UINT64 recorderHeld; // the records kept by the flight recorder
+    UINT64 recorderCapacity;
+    UINT32 isFinished;
+    UINT32 sequence; // guards the 64-bit fields of the header (see: LiveStatus)
+}; // 72 bytes
+
+struct s_live_status {
+    s_live_header header;
+    s_live_thread threads[LIVE_THREADS_MAX];
+};
+
+/**
+    The counters of the running tool, exposed in a small file mapped into the memory, so that the progress of a long trace
+    can be watched without touching its output. The rates (i.e. events per second) are computed by the reader, between its samples.
+    Each field has a single writer at a time (the global ones are written under the client lock, the per-thread ones by their thread),
+    so they are updated with plain stores to the volatile memory, without any read-modify-write.
+    The 64-bit stores are not atomic on IA-32, and the reader (another process) copies the fields in any chunks anyway,
+    so each group of fields is guarded by a sequence counter: odd while the group is being updated. The reader retries
+    when it finds the counter odd, or changed during its copy. No fences are needed, since the tool runs only on x86,
+    where the stores become visible in their program order, and the compiler keeps the order of the volatile accesses.
+    The threads with the IDs above LIVE_THREADS_MAX are counted only in the totals.
+*/
+class LiveStatus
+{
+public:
+    LiveStatus()
+        : m_status(NULL)
+    {
+    }
+
+    ~LiveStatus()
+    {
+        close();
+    }
+
+    // create the status file, and map it
+    bool init(const std::string &fileName);
+
+    bool isOpen() const
+    {
+        return m_status != NULL;
+    }
+
+    // the caller must hold the client lock
+    void addWrite(const THREADID tid, const size_t bytes)
+    {
+        if (!m_status) return;
+        volatile s_live_header &h = m_status->header;
+        beginUpdate(h.sequence);
+        h.eventsLogged = h.eventsLogged + 1;
+        h.bytesWritten = h.bytesWritten + bytes;
+        endUpdate(h.sequence);
+        volatile s_live_thread* t = thread(tid);
+        if (t) {
+            beginUpdate(t->sequence);
+            t->events = t->events + 1;
+            endUpdate(t->sequence);
+        }
+    }
+
+    // the caller must hold the client lock
+    void addFiltered()
+    {
+        if (!m_status) return;
+        volatile s_live_header &h = m_status->header;
+        beginUpdate(h.sequence);
+        h.eventsFiltered = h.eventsFiltered + 1;
+        endUpdate(h.sequence);
+    }
+
+    // the caller must hold the client lock
+    void addDropped(const size_t count)
+    {
+        if (!m_status) return;
+        volatile s_live_header &h = m_status->header;
+        beginUpdate(h.sequence);
+        h.eventsDropped = h.eventsDropped + count;
+        endUpdate(h.sequence);
+    }
+
+    // the caller must hold the client lock
+    void setRecorderFill(const size_t held, const size_t capacity)
+    {
+        if (!m_status) return;
+        volatile s_live_header &h = m_status->header;
+        beginUpdate(h.sequence);
+        h.recorderHeld = held;
+        h.recorderCapacity = capacity;
+        endUpdate(h.sequence);
+    }
+
+    void setThreadAlive(const THREADID tid, const bool isAlive);
+
+    void setSection(const THREADID tid, const std::string &name);
+
+    void setPendingCalls(const THREADID tid, const size_t count, const size_t max)
+    {
+        volatile s_live_thread* t = thread(tid);
+        if (!t) return;
+        beginUpdate(t->sequence);
+        t->pendingCalls = (UINT32)count;
+        t->pendingMax = (UINT32)max;
+        endUpdate(t->sequence);
+    }
+
+    // mark the trace as finished, and unmap the file
+    void close();
+
+protected:
+    // makes the sequence odd: the guarded fields are being updated
+    static void beginUpdate(volatile UINT32 &sequence)
+    {
+        sequence = sequence + 1;
+    }
+
+    // makes the sequence even again: the guarded fields are consistent
+    static void endUpdate(volatile UINT32 &sequence)
+    {
+        sequence = sequence + 1;
+    }
+
+    volatile s_live_thread* thread(const THREADID tid)
+    {
+        if (!m_status || tid >= LIVE_THREADS_MAX) return NULL;
+        return &m_status->threads[tid];
+    }
+
+    volatile s_live_status* m_status;
+};
@@ -0,0 +1,70 @@
+#include "MemWatch.h"
+
+#include <sstream>
+
+bool MemRanges::parse(const std::string &spec)
+{
+    std::string str = spec;
+    s_mem_range range;
+    range.isRva = true;
+    if (str.length() && str[0] == '@') {
+        range.isRva = false;
+        str = str.substr(1);
+    }
+    const size_t sep = str.find('-');
+    if (sep == std::string::npos) {
+        return false;
+    }
+    {
+        std::stringstream ss;
+        ss << std::hex << str.substr(0, sep);
+        if (!(ss >> range.start)) return false;
+    }
+    {
+        std::stringstream ss;
+        ss << std::hex << str.substr(sep + 1);
+        if (!(ss >> range.end)) return false;
+    }
+    if (range.end <= range.start) {
+        return false;
+    }
+    m_ranges.push_back(range);
+    updateBox();
+    return true;
+}
+
+void MemRanges::resolve(const ADDRINT moduleBase)
+{
+    for (size_t i = 0; i < m_ranges.size(); i++) {
+        s_mem_range &range = m_ranges[i];
+        if (!range.isRva) continue;
+        range.start += moduleBase;
+        range.end += moduleBase;
+        range.isRva = false;
+    }
+    updateBox();
+}
+
+bool MemRanges::overlaps(const ADDRINT addr, const UINT32 size) const
+{
+    for (size_t i = 0; i < m_ranges.size(); i++) {
+        const s_mem_range &range = m_ranges[i];
+        if (range.isRva) continue; // not resolved yet
+        if (addr < range.end && addr + size > range.start) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MemRanges::updateBox()
+{
+    bool isFirst = true;
+    for (size_t i = 0; i < m_ranges.size(); i++) {
+        const s_mem_range &range = m_ranges[i];
+        if (range.isRva) continue;
+        if (isFirst || range.start < m_boxStart) m_boxStart = range.start;
+        if (isFirst || range.end > m_boxEnd) m_boxEnd = range.end;
+        isFirst = false;
+    }
+}
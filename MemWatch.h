@@ -0,0 +1,135 @@
+#pragma once
+
+#include "pin.H"
+
+#include <string>
+#include <vector>
+
+#define MEM_ACCESS_BUF_MAX 1024
+
+struct s_mem_range {
+    ADDRINT start;
+    ADDRINT end; // exclusive
+    bool isRva; // relative to the base of the traced module
+};
+
+/**
+    The ranges of the memory, accesses to which are going to be logged.
+    The RVAs are converted to the absolute addresses when the traced module gets loaded.
+*/
+class MemRanges
+{
+public:
+    MemRanges()
+        : m_boxStart(0), m_boxEnd(0)
+    {
+    }
+
+    /**
+        Loads the range in the format: <start>-<end> (RVAs), or @<start>-<end> (absolute addresses), hexadecimal.
+        \return : true if the range is valid
+    */
+    bool parse(const std::string &spec);
+
+    // convert the RVAs into the absolute addresses, within the traced module
+    void resolve(const ADDRINT moduleBase);
+
+    bool isEmpty() const
+    {
+        return m_ranges.empty();
+    }
+
+    // quick check against the box bounding all of the ranges (cheap enough to be inlined)
+    bool isInBox(const ADDRINT addr, const UINT32 size) const
+    {
+        return (addr < m_boxEnd) && (addr + size > m_boxStart);
+    }
+
+    // precise check against each of the (resolved) ranges
+    bool overlaps(const ADDRINT addr, const UINT32 size) const;
+
+protected:
+    void updateBox();
+
+    std::vector<s_mem_range> m_ranges;
+    ADDRINT m_boxStart;
+    ADDRINT m_boxEnd;
+};
+
+struct s_mem_access {
+    ADDRINT insAddr;
+    ADDRINT addr;
+    UINT32 size;
+    UINT32 count; // the number of the accesses merged into this one
+    bool isWrite;
+};
+
+/**
+    Per-thread buffer of the accesses. The adjacent accesses done by the same instruction
+    (i.e. in a loop decrypting a string) are merged into one.
+*/
+class MemAccessBuffer
+{
+public:
+    MemAccessBuffer()
+        : m_count(0)
+    {
+    }
+
+    /**
+        Adds the access, merging it with the previous one if possible.
+        \return : false if the buffer is full and must be flushed first
+    */
+    bool add(const ADDRINT insAddr, const ADDRINT addr, const UINT32 size, const bool isWrite)
+    {
+        if (m_count > 0) {
+            s_mem_access &last = m_accesses[m_count - 1];
+            if (last.insAddr == insAddr && last.isWrite == isWrite) {
+                if (addr == last.addr + last.size) {
+                    last.size += size;
+                    last.count++;
+                    return true;
+                }
+                if (addr + size == last.addr) {
+                    last.addr = addr;
+                    last.size += size;
+                    last.count++;
+                    return true;
+                }
+                if (addr == last.addr && size == last.size) {
+                    last.count++;
+                    return true;
+                }
+            }
+        }
+        if (m_count == MEM_ACCESS_BUF_MAX) {
+            return false;
+        }
+        s_mem_access &next = m_accesses[m_count++];
+        next.insAddr = insAddr;
+        next.addr = addr;
+        next.size = size;
+        next.count = 1;
+        next.isWrite = isWrite;
+        return true;
+    }
+
+    size_t count() const
+    {
+        return m_count;
+    }
+
+    const s_mem_access& at(const size_t index) const
+    {
+        return m_accesses[index];
+    }
+
+    void clear()
+    {
+        m_count = 0;
+    }
+
+protected:
+    s_mem_access m_accesses[MEM_ACCESS_BUF_MAX];
+    size_t m_count;
+};
@@ -0,0 +1,59 @@
+#include "ModuleMatrix.h"
+
+#include <fstream>
+
+#include "Util.h"
+
+UINT16 ModuleIds::addModule(const ADDRINT start, const ADDRINT end, const std::string &name)
+{
+    UINT16 id = MODULE_ID_UNKNOWN;
+    std::map<std::string, UINT16>::const_iterator found = m_idsByPath.find(name);
+    if (found != m_idsByPath.end()) {
+        id = found->second;
+    }
+    else {
+        if (m_names.size() == MODULE_IDS_MAX) {
+            m_overLimit++;
+            return MODULE_ID_UNKNOWN;
+        }
+        id = (UINT16)m_names.size();
+        m_names.push_back(util::getDllName(name));
+        m_idsByPath[name] = id;
+    }
+    m_ranges.add(start, end, id);
+    return id;
+}
+
+//---
+
+void TransitionMatrix::merge(const TransitionMatrix &other)
+{
+    for (size_t from = 0; from < MODULE_IDS_MAX; from++) {
+        for (size_t to = 0; to < MODULE_IDS_MAX; to++) {
+            m_counts[from][to] += other.m_counts[from][to];
+        }
+    }
+}
+
+bool TransitionMatrix::write(const std::string &fileName, const ModuleIds &ids) const
+{
+    std::ofstream file(fileName.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "# modules" << std::endl;
+    if (ids.countOverLimit()) {
+        file << "# modules over the limit, counted as " << MODULE_ID_UNKNOWN << ": " << std::dec << ids.countOverLimit() << std::endl;
+    }
+    for (size_t id = 0; id < ids.count(); id++) {
+        file << std::dec << id << ";" << ids.getName((UINT16)id) << std::endl;
+    }
+    file << "# transitions: from;to;count" << std::endl;
+    for (size_t from = 0; from < ids.count(); from++) {
+        for (size_t to = 0; to < ids.count(); to++) {
+            if (!m_counts[from][to]) continue;
+            file << std::dec << from << ";" << to << ";" << m_counts[from][to] << std::endl;
+        }
+    }
+    return true;
+}
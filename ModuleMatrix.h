@@ -0,0 +1,95 @@
+#pragma once
+
+#include "pin.H"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "RangeSet.h"
+
+#define MODULE_IDS_MAX 256
+#define MODULE_ID_UNKNOWN 0 // shellcodes, and the modules above the limit
+
+/**
+    Ids of the modules, assigned at the load. A module loaded again (by the same path) gets its previous id.
+    The lookup by address is lock-free (see: RangeSet).
+*/
+class ModuleIds
+{
+public:
+    ModuleIds()
+        : m_overLimit(0)
+    {
+        m_names.push_back("?"); // MODULE_ID_UNKNOWN
+    }
+
+    /**
+        Called under the client lock.
+        \return : the id of the module, or MODULE_ID_UNKNOWN if the limit of the ids was reached
+    */
+    UINT16 addModule(const ADDRINT start, const ADDRINT end, const std::string &name);
+
+    // called under the client lock
+    void removeModule(const ADDRINT start)
+    {
+        m_ranges.remove(start);
+    }
+
+    UINT16 findId(const ADDRINT addr) const
+    {
+        UINT32 id = MODULE_ID_UNKNOWN;
+        if (!m_ranges.find(addr, id)) {
+            return MODULE_ID_UNKNOWN;
+        }
+        return (UINT16)id;
+    }
+
+    size_t count() const
+    {
+        return m_names.size();
+    }
+
+    const std::string& getName(const UINT16 id) const
+    {
+        return m_names[id];
+    }
+
+    // the modules that did not get their own id, counted as MODULE_ID_UNKNOWN
+    size_t countOverLimit() const
+    {
+        return m_overLimit;
+    }
+
+protected:
+    std::vector<std::string> m_names; // indexed by the id
+    std::map<std::string, UINT16> m_idsByPath;
+    size_t m_overLimit;
+    RangeSet m_ranges;
+};
+
+/**
+    Dense matrix of the transitions between the modules, counted by a single thread.
+    Big (MODULE_IDS_MAX^2 counters): to be allocated only when needed.
+*/
+class TransitionMatrix
+{
+public:
+    TransitionMatrix()
+    {
+        ::memset(m_counts, 0, sizeof(m_counts));
+    }
+
+    void add(const UINT16 fromId, const UINT16 toId)
+    {
+        m_counts[fromId][toId]++;
+    }
+
+    void merge(const TransitionMatrix &other);
+
+    // writes the list of the modules, and the non-zero transitions
+    bool write(const std::string &fileName, const ModuleIds &ids) const;
+
+protected:
+    UINT64 m_counts[MODULE_IDS_MAX][MODULE_IDS_MAX];
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "pin.H"
+
+#include <string>
+
+// the maximal length of the string that is printed
+#define PARAM_MAX_STR 300
+
+/**
+    Formats the parameter of the watched function: as a string (ASCII or wide), if it points to one,
+    otherwise as a pointer, or a single value.
+*/
+std::wstring paramToStr(VOID *arg1);
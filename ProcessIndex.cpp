@@ -0,0 +1,35 @@
+#include "ProcessIndex.h"
+
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+bool ProcessIndex::appendLine(const std::string &line, const bool isNew)
+{
+    if (m_fileName.empty()) {
+        return false;
+    }
+    std::ofstream file(m_fileName.c_str(), isNew ? std::ios::trunc : std::ios::app);
+    if (!file.is_open()) {
+        return false;
+    }
+    // written at once, so that the lines of the different processes do not interleave
+    file.write(line.c_str(), line.length());
+    return true;
+}
+
+bool ProcessIndex::logStart(const INT parentPid, const std::string &outputFile, const std::string &module)
+{
+    std::stringstream ss;
+    ss << "start;" << std::dec << m_pid << ";" << parentPid << ";" << (UINT64)time(NULL) << ";" << outputFile << ";" << module << "\n";
+    // the root process: no children were started yet
+    const bool isRoot = (parentPid == 0);
+    return appendLine(ss.str(), isRoot);
+}
+
+bool ProcessIndex::logStop(const INT32 exitCode)
+{
+    std::stringstream ss;
+    ss << "stop;" << std::dec << m_pid << ";" << exitCode << ";" << (UINT64)time(NULL) << "\n";
+    return appendLine(ss.str());
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "pin.H"
+
+#include <string>
+
+/**
+    The index of the traced processes, shared by the whole process tree.
+    Each process appends its own records, one line per write:
+        start;<pid>;<parent_pid>;<time>;<output file>;<module>
+        stop;<pid>;<exit code>;<time>
+    The time is in seconds since the epoch.
+    The root of the tree (without a parent) starts a new index, so that the records of the previous runs are not mixed in.
+*/
+class ProcessIndex
+{
+public:
+    ProcessIndex()
+        : m_pid(0)
+    {
+    }
+
+    void init(const std::string &fileName, const INT pid)
+    {
+        m_fileName = fileName;
+        m_pid = pid;
+    }
+
+    bool logStart(const INT parentPid, const std::string &outputFile, const std::string &module);
+
+    bool logStop(const INT32 exitCode);
+
+protected:
+    bool appendLine(const std::string &line, const bool isNew = false);
+
+    std::string m_fileName;
+    INT m_pid;
+};
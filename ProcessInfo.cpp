@@ -1,9 +1,47 @@
 #include "ProcessInfo.h"
 
+#include <sstream>
+
+#include "Util.h"
+
 //----
 
+bool wildcard_match(const char* str, const char* pattern)
+{
+    const char* starPattern = nullptr;
+    const char* starStr = nullptr;
+    while (*str) {
+        if (*pattern == '*') {
+            starPattern = pattern++;
+            starStr = str;
+        }
+        else if (*pattern == '?' || ::tolower(*pattern) == ::tolower(*str)) {
+            pattern++;
+            str++;
+        }
+        else if (starPattern) {
+            // backtrack: let the last star consume one more char
+            pattern = starPattern + 1;
+            str = ++starStr;
+        }
+        else {
+            return false;
+        }
+    }
+    while (*pattern == '*') {
+        pattern++;
+    }
+    return *pattern == '\0';
+}
+
 bool is_my_name(const std::string &module_name, std::string my_name)
 {
+    if (my_name.find_first_of("*?") != std::string::npos) {
+        // a pattern: match the file name
+        const std::size_t sep = module_name.find_last_of("/\\");
+        const std::string file_name = (sep == std::string::npos) ? module_name : module_name.substr(sep + 1);
+        return wildcard_match(file_name.c_str(), my_name.c_str());
+    }
     std::size_t found = module_name.find(my_name);
     if (found != std::string::npos) {
         return true;
@@ -11,40 +49,96 @@ bool is_my_name(const std::string &module_name, std::string my_name)
     return false;
 }
 
-void ProcessInfo::addModuleSections(IMG Image, ADDRINT ImageBase)
+bool ProcessInfo::init(std::string apps)
+{
+    if (isInit) {
+        return false; // already initialized
+    }
+    std::string app;
+    std::istringstream f(apps);
+    while (getline(f, app, ',')) {
+        std::string name;
+        std::istringstream f2(app);
+        while (getline(f2, name, ';')) {
+            if (name.length()) {
+                m_AnalysedApps.push_back(name);
+            }
+        }
+    }
+    m_myPid = 0; //UNKNOWN
+    isInit = true;
+    return true;
+}
+
+void ProcessInfo::addModuleSections(s_traced_module &mod, IMG Image)
 {
     // enumerate sections within the analysed module
     for (SEC sec = IMG_SecHead(Image); SEC_Valid(sec); sec = SEC_Next(sec)) {
         s_module section;
-        init_section(section, ImageBase, sec);
-        m_Sections[section.start] = section;
+        init_section(section, mod.base, sec);
+        mod.sections[section.start] = section;
     }
 }
 
 bool ProcessInfo::addModule(IMG Image)
 {
     // if this module is an object of observation, add its sections also
-    if (m_myPid == 0 && is_my_name(IMG_Name(Image), m_AnalysedApp)) {
+    bool isMy = false;
+    for (size_t i = 0; i < m_AnalysedApps.size(); i++) {
+        if (is_my_name(IMG_Name(Image), m_AnalysedApps[i])) {
+            isMy = true;
+            break;
+        }
+    }
+    if (!isMy || isMyAddress(IMG_LoadOffset(Image))) {
+        return true;
+    }
+    if (m_myPid == 0) {
         m_myPid = PIN_GetPid();
-        myModuleBase = IMG_LoadOffset(Image);
-        addModuleSections(Image, myModuleBase);
     }
+    s_traced_module* mod = new s_traced_module();
+    mod->name = IMG_Name(Image);
+    mod->base = IMG_LoadOffset(Image);
+    mod->end = IMG_HighAddress(Image);
+    addModuleSections(*mod, Image);
+
+    const UINT32 id = (UINT32)m_modules.size();
+    m_modules.push_back(mod);
+    m_ranges.add(mod->base, mod->end, id);
     return true;
 }
 
-const bool ProcessInfo::updateTracedModuleSection(ADDRINT Rva)
+void ProcessInfo::removeModule(IMG Image)
 {
-    // saved section (of the target module)
-    static s_module* prevSec = nullptr;
+    const ADDRINT base = IMG_LoadOffset(Image);
+    if (!isMyAddress(base)) {
+        return;
+    }
+    // the module data is kept: only its range is released
+    m_ranges.remove(base);
+    m_prevSection = nullptr;
+}
 
-    // current section of the target module (by RVA)
-    const s_module* currSec = getSecByAddr(Rva);
+std::string ProcessInfo::getSecName(ADDRINT Address)
+{
+    const s_module* sec = getSecByAddr(Address);
+    std::string name = (sec) ? sec->name : "?";
+    const s_traced_module* mod = getTracedModule(Address);
+    if (mod && mod != getMainModule()) {
+        name = util::getDllName(mod->name) + ":" + name;
+    }
+    return name;
+}
 
-    if (prevSec != currSec) {
+const bool ProcessInfo::updateTracedModuleSection(ADDRINT Address)
+{
+    // current section of the traced modules (by address)
+    const s_module* currSec = getSecByAddr(Address);
+
+    if (m_prevSection != currSec) {
         // update the stored section
-        prevSec = (s_module*)currSec;
+        m_prevSection = currSec;
         return true;
     }
     return false;
 }
-
@@ -3,67 +3,113 @@
 #include "pin.H"
 
 #include <map>
+#include <vector>
 #include "ModuleInfo.h"
+#include "RangeSet.h"
+
+struct s_traced_module {
+    std::string name;
+    ADDRINT base;
+    ADDRINT end; // the highest address
+    std::map<ADDRINT, s_module> sections; // by RVA
+};
 
 class ProcessInfo
 {
 public:
     ProcessInfo()
-        : m_myPid(0), isInit(false)
+        : m_prevSection(nullptr), m_myPid(0), isInit(false)
     {
     }
 
-    bool init(std::string app)
+    ~ProcessInfo()
     {
-        if (isInit) {
-            return false; // already initialized
+        for (size_t i = 0; i < m_modules.size(); i++) {
+            delete m_modules[i];
         }
-        m_AnalysedApp = app;
-        m_myPid = 0; //UNKNOWN
-        isInit = true;
-        myModuleBase = UNKNOWN_ADDR;
-        return true;
     }
 
+    /**
+        Sets the modules to be traced.
+        \param apps : list of the names (or their parts), separated by ',' or ';'. The wildcards '*' and '?' match the file name.
+    */
+    bool init(std::string apps);
+
     bool addModule(IMG Image);
 
+    void removeModule(IMG Image);
+
+    // the first of the traced modules that got loaded (its events are logged with the RVA only)
+    const s_traced_module* getMainModule() const
+    {
+        return (m_modules.size()) ? m_modules[0] : nullptr;
+    }
+
+    const s_traced_module* getTracedModule(ADDRINT Address) const
+    {
+        UINT32 id = 0;
+        if (!m_ranges.find(Address, id)) {
+            return nullptr;
+        }
+        return m_modules[id];
+    }
+
+    // get the section of the traced module by the (absolute) address
     const s_module* getSecByAddr(ADDRINT Address)
     {
-        return get_by_addr(Address, m_Sections);
+        UINT32 id = 0;
+        if (!m_ranges.find(Address, id)) {
+            return nullptr;
+        }
+        s_traced_module* mod = m_modules[id];
+        return get_by_addr(Address - mod->base, mod->sections);
     }
 
-    bool isMyAddress(ADDRINT Address)
+    // get the name of the section, prefixed with the module name, unless it is the main traced module
+    std::string getSecName(ADDRINT Address);
+
+    /**
+        Fast check, not requiring the image lookup (safe to be used in the analysis routines).
+        \return : true if the address is within any of the traced modules
+    */
+    bool isMyAddress(ADDRINT Address) const
     {
         if (Address == UNKNOWN_ADDR) {
             return false;
         }
-        IMG myImg = IMG_FindByAddress(myModuleBase);
-        IMG otherImg = IMG_FindByAddress(Address);
-        if (!IMG_Valid(myImg) || !IMG_Valid(otherImg)) {
-            return false;
-        }
-        if (IMG_LoadOffset(myImg) == IMG_LoadOffset(otherImg)) {
-            return true;
+        return m_ranges.contains(Address);
+    }
+
+    /**
+        The base to be logged along with the RVA.
+        \return : 0 for the main traced module, or the base of any other traced module
+    */
+    ADDRINT getLogBase(ADDRINT Address) const
+    {
+        const s_traced_module* mod = getTracedModule(Address);
+        if (!mod || mod == getMainModule()) {
+            return 0;
         }
-        return false;
+        return mod->base;
     }
 
     /** 
-        Saves the transition between sections witing the target module.
-        \param Rva : current RVA witin the target module
+        Saves the transition between sections witing the traced modules.
+        \param Address : current address within the traced module
         \return : true if the section changed, false otherwise
     */
-    const bool updateTracedModuleSection(ADDRINT Rva);
+    const bool updateTracedModuleSection(ADDRINT Address);
     
 protected:
     
-    void addModuleSections(IMG Image, ADDRINT ImageBase);
+    void addModuleSections(s_traced_module &mod, IMG Image);
 
-    std::map<ADDRINT, s_module> m_Sections;
-    ADDRINT myModuleBase;
+    std::vector<std::string> m_AnalysedApps;
+    std::vector<s_traced_module*> m_modules; // indexed by the id in the ranges
+    RangeSet m_ranges;
+
+    const s_module* m_prevSection; // last section of the traced modules
 
-    std::string m_AnalysedApp;
     INT m_myPid;
     bool isInit;
 };
-
@@ -0,0 +1,53 @@
+#include "RangeSet.h"
+
+#include <algorithm>
+
+bool compareRanges(const s_range &a, const s_range &b)
+{
+    return a.start < b.start;
+}
+
+RangeSet::RangeSet()
+{
+    m_ranges = new std::vector<s_range>();
+}
+
+RangeSet::~RangeSet()
+{
+    delete m_ranges;
+    for (size_t i = 0; i < m_retired.size(); i++) {
+        delete m_retired[i];
+    }
+}
+
+void RangeSet::publish(std::vector<s_range>* ranges)
+{
+    std::sort(ranges->begin(), ranges->end(), compareRanges);
+    // the analysis routines may still be reading the previous copy
+    std::vector<s_range>* prev = m_ranges;
+    m_retired.push_back(prev);
+    m_ranges = ranges;
+}
+
+void RangeSet::add(const ADDRINT start, const ADDRINT end, const UINT32 id)
+{
+    s_range range;
+    range.start = start;
+    range.end = end;
+    range.id = id;
+
+    std::vector<s_range>* ranges = new std::vector<s_range>(*m_ranges);
+    ranges->push_back(range);
+    publish(ranges);
+}
+
+void RangeSet::remove(const ADDRINT start)
+{
+    std::vector<s_range>* ranges = new std::vector<s_range>();
+    for (size_t i = 0; i < m_ranges->size(); i++) {
+        if ((*m_ranges)[i].start != start) {
+            ranges->push_back((*m_ranges)[i]);
+        }
+    }
+    publish(ranges);
+}
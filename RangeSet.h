@@ -0,0 +1,67 @@
+#pragma once
+
+#include "pin.H"
+
+#include <vector>
+
+struct s_range {
+    ADDRINT start;
+    ADDRINT end; // inclusive
+    UINT32 id;
+};
+
+/**
+    Small sorted set of the address ranges, each with an id.
+    The lookup is lock-free: the sorted array is never modified, but replaced by a new copy
+    on each change (the old copies are released at the end). The changes must be synchronized by the caller.
+*/
+class RangeSet
+{
+public:
+    RangeSet();
+    ~RangeSet();
+
+    void add(const ADDRINT start, const ADDRINT end, const UINT32 id);
+
+    // remove the range starting at the given address
+    void remove(const ADDRINT start);
+
+    bool find(const ADDRINT addr, UINT32 &id) const
+    {
+        const std::vector<s_range>* ranges = m_ranges;
+        size_t low = 0;
+        size_t high = ranges->size();
+        while (low < high) {
+            const size_t mid = (low + high) / 2;
+            const s_range &range = (*ranges)[mid];
+            if (addr < range.start) {
+                high = mid;
+            }
+            else if (addr > range.end) {
+                low = mid + 1;
+            }
+            else {
+                id = range.id;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool contains(const ADDRINT addr) const
+    {
+        UINT32 id = 0;
+        return find(addr, id);
+    }
+
+    bool isEmpty() const
+    {
+        return m_ranges->empty();
+    }
+
+protected:
+    void publish(std::vector<s_range>* ranges);
+
+    std::vector<s_range>* volatile m_ranges; // sorted by the start
+    std::vector< std::vector<s_range>* > m_retired;
+};
@@ -0,0 +1,278 @@
+#include "ReplayRecord.h"
+
+#include <cstring>
+
+bool ReplayWriter::init(const std::string &fileName, const std::vector<std::string> &toolArgs)
+{
+    m_file.open(fileName.c_str(), std::ios::binary | std::ios::out);
+    if (!m_file.is_open()) {
+        return false;
+    }
+    const UINT32 version = REPLAY_VERSION;
+    const UINT32 argsCount = (UINT32)toolArgs.size();
+    put(REPLAY_MAGIC, 4);
+    put(&version, sizeof(version));
+    put(&argsCount, sizeof(argsCount));
+    for (size_t i = 0; i < toolArgs.size(); i++) {
+        putString(toolArgs[i]);
+    }
+    flush();
+    return true;
+}
+
+void ReplayWriter::put(const void* data, const size_t size)
+{
+    if (m_used + size > REPLAY_BUFFER_SIZE) {
+        flush();
+    }
+    if (size > REPLAY_BUFFER_SIZE) {
+        m_file.write(static_cast<const char*>(data), size);
+        return;
+    }
+    ::memcpy(m_buffer + m_used, data, size);
+    m_used += size;
+}
+
+void ReplayWriter::flush()
+{
+    if (m_used && m_file.is_open()) {
+        m_file.write(m_buffer, m_used);
+    }
+    m_used = 0;
+}
+
+void ReplayWriter::beginRecord(const t_record_type type, const THREADID tid)
+{
+    const UINT8 recType = (UINT8)type;
+    const UINT32 recTid = (UINT32)tid;
+    put(&recType, sizeof(recType));
+    put(&recTid, sizeof(recTid));
+}
+
+void ReplayWriter::recordImageLoad(IMG Image)
+{
+    if (!isOpen()) return;
+
+    std::vector<s_rec_range> sections;
+    std::vector<s_rec_range> routines;
+    for (SEC sec = IMG_SecHead(Image); SEC_Valid(sec); sec = SEC_Next(sec)) {
+        s_rec_range secRange = { SEC_Name(sec), SEC_Address(sec), SEC_Size(sec) };
+        sections.push_back(secRange);
+        for (RTN rtn = SEC_RtnHead(sec); RTN_Valid(rtn); rtn = RTN_Next(rtn)) {
+            s_rec_range rtnRange = { RTN_Name(rtn), RTN_Address(rtn), RTN_Size(rtn) };
+            routines.push_back(rtnRange);
+        }
+    }
+
+    PIN_GetLock(&m_lock, PIN_ThreadId() + 1);
+    beginRecord(REC_IMAGE_LOAD, PIN_ThreadId());
+    putString(IMG_Name(Image));
+    putValue(IMG_LowAddress(Image));
+    putValue(IMG_HighAddress(Image));
+    putValue(IMG_LoadOffset(Image));
+    putValue(IMG_IsMainExecutable(Image) ? 1 : 0);
+    for (size_t k = 0; k < 2; k++) {
+        const std::vector<s_rec_range> &ranges = (k == 0) ? sections : routines;
+        const UINT32 count = (UINT32)ranges.size();
+        put(&count, sizeof(count));
+        for (size_t i = 0; i < ranges.size(); i++) {
+            putString(ranges[i].name);
+            putValue(ranges[i].start);
+            putValue(ranges[i].size);
+        }
+    }
+    PIN_ReleaseLock(&m_lock);
+}
+
+void ReplayWriter::recordImageUnload(IMG Image)
+{
+    if (!isOpen()) return;
+
+    PIN_GetLock(&m_lock, PIN_ThreadId() + 1);
+    beginRecord(REC_IMAGE_UNLOAD, PIN_ThreadId());
+    putValue(IMG_LowAddress(Image));
+    PIN_ReleaseLock(&m_lock);
+}
+
+void ReplayWriter::recordThread(const t_record_type type, const THREADID tid)
+{
+    if (!isOpen()) return;
+
+    PIN_GetLock(&m_lock, tid + 1);
+    beginRecord(type, tid);
+    PIN_ReleaseLock(&m_lock);
+}
+
+void ReplayWriter::recordTransition(const THREADID tid, const ADDRINT addrFrom, const ADDRINT addrTo)
+{
+    if (!isOpen()) return;
+
+    PIN_GetLock(&m_lock, tid + 1);
+    beginRecord(REC_TRANSITION, tid);
+    putValue(addrFrom);
+    putValue(addrTo);
+    PIN_ReleaseLock(&m_lock);
+}
+
+void ReplayWriter::recordRdtsc(const THREADID tid, const ADDRINT Address)
+{
+    if (!isOpen()) return;
+
+    PIN_GetLock(&m_lock, tid + 1);
+    beginRecord(REC_RDTSC, tid);
+    putValue(Address);
+    PIN_ReleaseLock(&m_lock);
+}
+
+void ReplayWriter::recordCpuid(const THREADID tid, const ADDRINT Address, const ADDRINT param)
+{
+    if (!isOpen()) return;
+
+    PIN_GetLock(&m_lock, tid + 1);
+    beginRecord(REC_CPUID, tid);
+    putValue(Address);
+    putValue(param);
+    PIN_ReleaseLock(&m_lock);
+}
+
+void ReplayWriter::recordFuncArgs(const THREADID tid, const UINT32 funcId, const ADDRINT stackPtr, const ADDRINT retAddr, const CHAR* name, const UINT32 argCount, VOID** args)
+{
+    if (!isOpen()) return;
+
+    char snapshot[REPLAY_SNAPSHOT_MAX];
+
+    PIN_GetLock(&m_lock, tid + 1);
+    beginRecord(REC_FUNC_ARGS, tid);
+    put(&funcId, sizeof(funcId));
+    putValue(stackPtr);
+    putValue(retAddr);
+    putString(name ? name : "");
+    put(&argCount, sizeof(argCount));
+    for (UINT32 i = 0; i < argCount; i++) {
+        putValue((ADDRINT)args[i]);
+        UINT32 size = 0;
+        if (args[i] && PIN_CheckReadAccess(args[i])) {
+            size = (UINT32)PIN_SafeCopy(snapshot, args[i], sizeof(snapshot));
+        }
+        put(&size, sizeof(size));
+        put(snapshot, size);
+    }
+    PIN_ReleaseLock(&m_lock);
+}
+
+void ReplayWriter::close()
+{
+    PIN_GetLock(&m_lock, PIN_ThreadId() + 1);
+    if (m_file.is_open()) {
+        flush();
+        m_file.close();
+    }
+    PIN_ReleaseLock(&m_lock);
+}
+
+//---
+
+bool ReplayReader::open(const std::string &fileName)
+{
+    m_file.open(fileName.c_str(), std::ios::binary | std::ios::in);
+    if (!m_file.is_open()) {
+        return false;
+    }
+    char magic[4] = { 0 };
+    UINT32 version = 0;
+    UINT32 argsCount = 0;
+    if (!get(magic, sizeof(magic)) || ::memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0
+        || !get(&version, sizeof(version)) || version != REPLAY_VERSION
+        || !get(&argsCount, sizeof(argsCount)))
+    {
+        return false;
+    }
+    for (UINT32 i = 0; i < argsCount; i++) {
+        std::string arg;
+        if (!getString(arg)) return false;
+        m_toolArgs.push_back(arg);
+    }
+    return true;
+}
+
+bool ReplayReader::getString(std::string &str)
+{
+    UINT32 len = 0;
+    if (!get(&len, sizeof(len))) return false;
+    str.resize(len);
+    if (len == 0) return true;
+    return get(&str[0], len);
+}
+
+bool ReplayReader::getRanges(std::vector<s_rec_range> &ranges)
+{
+    UINT32 count = 0;
+    if (!get(&count, sizeof(count))) return false;
+    ranges.resize(count);
+    for (UINT32 i = 0; i < count; i++) {
+        if (!getString(ranges[i].name)
+            || !get(&ranges[i].start, sizeof(UINT64))
+            || !get(&ranges[i].size, sizeof(UINT64)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ReplayReader::next(s_record &rec)
+{
+    if (!get(&rec.type, sizeof(rec.type)) || !get(&rec.tid, sizeof(rec.tid))) {
+        return false;
+    }
+    switch (rec.type) {
+    case REC_IMAGE_LOAD:
+    {
+        UINT64 isMain = 0;
+        if (!getString(rec.image.name)
+            || !get(&rec.image.low, sizeof(UINT64))
+            || !get(&rec.image.high, sizeof(UINT64))
+            || !get(&rec.image.loadOffset, sizeof(UINT64))
+            || !get(&isMain, sizeof(isMain)))
+        {
+            return false;
+        }
+        rec.image.isMain = (isMain != 0);
+        return getRanges(rec.image.sections) && getRanges(rec.image.routines);
+    }
+    case REC_IMAGE_UNLOAD:
+    case REC_RDTSC:
+        return get(&rec.values[0], sizeof(UINT64));
+    case REC_THREAD_START:
+    case REC_THREAD_FINI:
+        return true;
+    case REC_TRANSITION:
+    case REC_CPUID:
+        return get(&rec.values[0], sizeof(UINT64)) && get(&rec.values[1], sizeof(UINT64));
+    case REC_FUNC_ARGS:
+    {
+        UINT32 argCount = 0;
+        if (!get(&rec.funcId, sizeof(rec.funcId))
+            || !get(&rec.values[0], sizeof(UINT64))
+            || !get(&rec.values[1], sizeof(UINT64))
+            || !getString(rec.name)
+            || !get(&argCount, sizeof(argCount)))
+        {
+            return false;
+        }
+        rec.args.resize(argCount);
+        for (UINT32 i = 0; i < argCount; i++) {
+            UINT32 size = 0;
+            if (!get(&rec.args[i].value, sizeof(UINT64)) || !get(&size, sizeof(size))) {
+                return false;
+            }
+            rec.args[i].snapshot.resize(size);
+            if (size && !get(&rec.args[i].snapshot[0], size)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    }
+    return false; // unknown record
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "pin.H"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ParamStr.h"
+
+#define REPLAY_MAGIC "TTRP"
+#define REPLAY_VERSION 1
+
+// the bytes saved under each argument of the watched function: enough to format it as a string (see: paramToStr)
+#define REPLAY_SNAPSHOT_MAX ((PARAM_MAX_STR + 1) * sizeof(wchar_t))
+
+#define REPLAY_BUFFER_SIZE 0x10000
+
+typedef enum {
+    REC_NONE = 0,
+    REC_IMAGE_LOAD,
+    REC_IMAGE_UNLOAD,
+    REC_THREAD_START,
+    REC_THREAD_FINI,
+    REC_TRANSITION,
+    REC_RDTSC,
+    REC_CPUID,
+    REC_FUNC_ARGS,
+    REC_TYPES_COUNT
+} t_record_type;
+
+struct s_rec_range {
+    std::string name;
+    UINT64 start;
+    UINT64 size;
+};
+
+struct s_rec_image {
+    std::string name;
+    UINT64 low;
+    UINT64 high;
+    UINT64 loadOffset;
+    bool isMain;
+    std::vector<s_rec_range> sections;
+    std::vector<s_rec_range> routines;
+};
+
+struct s_rec_arg {
+    UINT64 value;
+    std::string snapshot; // the memory under the argument, if it was readable
+};
+
+/**
+    A single input of the analysis routines, as read back from the recording.
+*/
+struct s_record {
+    s_record()
+        : type(REC_NONE), tid(0), funcId(0)
+    {
+        values[0] = values[1] = 0;
+    }
+
+    UINT8 type;
+    UINT32 tid;
+    UINT64 values[2]; // transition: from, to; RDTSC: address; CPUID: address, param; function: stack pointer, return address
+    UINT32 funcId;
+    std::string name; // the watched function
+    s_rec_image image;
+    std::vector<s_rec_arg> args;
+};
+
+/**
+    Records the raw inputs of the analysis routines: the loaded images (with their sections and routines), the threads,
+    the transitions, the RDTSC/CPUID sites, and the arguments of the watched functions (along with the memory they point to).
+    They can be fed back through the same routines without Pin (see: bench/replay).
+*/
+class ReplayWriter
+{
+public:
+    ReplayWriter()
+        : m_used(0)
+    {
+        PIN_InitLock(&m_lock);
+    }
+
+    ~ReplayWriter()
+    {
+        close();
+    }
+
+    // create the recording, with the command line of the tool stored in the header
+    bool init(const std::string &fileName, const std::vector<std::string> &toolArgs);
+
+    bool isOpen() const
+    {
+        return m_file.is_open();
+    }
+
+    void recordImageLoad(IMG Image);
+    void recordImageUnload(IMG Image);
+    void recordThread(const t_record_type type, const THREADID tid);
+    void recordTransition(const THREADID tid, const ADDRINT addrFrom, const ADDRINT addrTo);
+    void recordRdtsc(const THREADID tid, const ADDRINT Address);
+    void recordCpuid(const THREADID tid, const ADDRINT Address, const ADDRINT param);
+    void recordFuncArgs(const THREADID tid, const UINT32 funcId, const ADDRINT stackPtr, const ADDRINT retAddr, const CHAR* name, const UINT32 argCount, VOID** args);
+
+    void close();
+
+protected:
+    void beginRecord(const t_record_type type, const THREADID tid);
+
+    void put(const void* data, const size_t size);
+
+    void putValue(const UINT64 value)
+    {
+        put(&value, sizeof(value));
+    }
+
+    void putString(const std::string &str)
+    {
+        const UINT32 len = (UINT32)str.length();
+        put(&len, sizeof(len));
+        put(str.c_str(), len);
+    }
+
+    void flush();
+
+    std::ofstream m_file;
+    char m_buffer[REPLAY_BUFFER_SIZE];
+    size_t m_used;
+    PIN_LOCK m_lock;
+};
+
+/**
+    Reads back the recording made by the ReplayWriter.
+*/
+class ReplayReader
+{
+public:
+    bool open(const std::string &fileName);
+
+    // the command line of the tool, with which the recording was made
+    const std::vector<std::string>& getToolArgs() const
+    {
+        return m_toolArgs;
+    }
+
+    // \return : false at the end of the recording, or if it is truncated
+    bool next(s_record &rec);
+
+protected:
+    bool get(void* data, const size_t size)
+    {
+        m_file.read(static_cast<char*>(data), size);
+        return m_file.good();
+    }
+
+    bool getString(std::string &str);
+    bool getRanges(std::vector<s_rec_range> &ranges);
+
+    std::ifstream m_file;
+    std::vector<std::string> m_toolArgs;
+};
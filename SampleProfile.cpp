@@ -0,0 +1,69 @@
+#include "SampleProfile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+bool SampleProfile::addSample(const ADDRINT addr)
+{
+    std::map<ADDRINT, size_t>::const_iterator found = m_addrToBucket.find(addr);
+    if (found == m_addrToBucket.end()) {
+        return false;
+    }
+    m_buckets[found->second].count++;
+    m_total++;
+    return true;
+}
+
+void SampleProfile::addAddress(const ADDRINT addr, const std::string &name, const t_sample_type type)
+{
+    size_t index = 0;
+    std::map<std::string, size_t>::const_iterator found = m_nameToBucket.find(name);
+    if (found != m_nameToBucket.end()) {
+        index = found->second;
+    }
+    else {
+        s_bucket bucket;
+        bucket.name = name;
+        bucket.type = type;
+        bucket.count = 0;
+        index = m_buckets.size();
+        m_buckets.push_back(bucket);
+        m_nameToBucket[name] = index;
+    }
+    m_addrToBucket[addr] = index;
+    m_buckets[index].count++;
+    m_total++;
+}
+
+bool compareBuckets(const std::pair<UINT64, size_t> &a, const std::pair<UINT64, size_t> &b)
+{
+    return a.first > b.first;
+}
+
+bool SampleProfile::write(const std::string &fileName, const size_t period) const
+{
+    static const char* typeNames[SAMPLE_TYPES_COUNT] = { "section", "shellcode", "api" };
+
+    std::ofstream file(fileName.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    std::vector< std::pair<UINT64, size_t> > sorted;
+    for (size_t i = 0; i < m_buckets.size(); i++) {
+        sorted.push_back(std::make_pair(m_buckets[i].count, i));
+    }
+    std::sort(sorted.begin(), sorted.end(), compareBuckets);
+
+    file << "# period=" << std::dec << period << ";samples=" << m_total << std::endl;
+    file << "samples;percent;type;name" << std::endl;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const s_bucket &bucket = m_buckets[sorted[i].second];
+        const double percent = m_total ? (100.0 * bucket.count / m_total) : 0;
+        file << std::dec << bucket.count << ";"
+            << std::fixed << std::setprecision(2) << percent << ";"
+            << typeNames[bucket.type] << ";"
+            << bucket.name << std::endl;
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "pin.H"
+
+#include <map>
+#include <string>
+#include <vector>
+
+typedef enum {
+    SAMPLE_SECTION = 0, // a section of the traced module
+    SAMPLE_SHELLCODE,   // a memory page that does not belong to any module
+    SAMPLE_API,         // a function of another module
+    SAMPLE_TYPES_COUNT
+} t_sample_type;
+
+/**
+    Flat profile built from the sampled addresses.
+    Each sampled address is resolved only once, to the bucket (i.e. a section or an API)
+    to which the samples are attributed.
+    Not synchronized: the caller must hold the client lock.
+*/
+class SampleProfile
+{
+public:
+    SampleProfile()
+        : m_total(0)
+    {
+    }
+
+    /**
+        Counts the sample, if its address was already resolved.
+        \return : false if the address needs to be resolved first (see: addAddress)
+    */
+    bool addSample(const ADDRINT addr);
+
+    // attribute the address to the bucket of the given name, and count the sample
+    void addAddress(const ADDRINT addr, const std::string &name, const t_sample_type type);
+
+    bool write(const std::string &fileName, const size_t period) const;
+
+protected:
+    struct s_bucket {
+        std::string name;
+        t_sample_type type;
+        UINT64 count;
+    };
+
+    std::map<ADDRINT, size_t> m_addrToBucket;
+    std::map<std::string, size_t> m_nameToBucket;
+    std::vector<s_bucket> m_buckets;
+    UINT64 m_total;
+};
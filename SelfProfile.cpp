@@ -0,0 +1,115 @@
+#include "SelfProfile.h"
+
+#include <fstream>
+
+#define DELIMITER ';'
+
+namespace {
+    const char* g_routineNames[PROF_ROUTINES_COUNT] = {
+        "transition",
+        "rdtsc",
+        "cpuid",
+        "rdtsc_alter",
+        "func_args",
+        "func_ret",
+        "syscall",
+        "mem_access",
+        "tainted_branch",
+        "sample",
+        "image",
+        "instrument_ins",
+        "instrument_trace"
+    };
+
+    void writeShare(std::ofstream &file, const char* name, const UINT64 ticks, const UINT64 total)
+    {
+        file << name << DELIMITER << std::dec << ticks << DELIMITER;
+        if (total) {
+            file << ((ticks * 1000 / total) / 10.0) << "%";
+        }
+        file << std::endl;
+    }
+};
+
+bool SelfProfile::writeReport(const std::string &fileName) const
+{
+    const UINT64 elapsed = util::getTimestamp() - m_startTime;
+
+    s_prof_counters sum;
+    ::memset(&sum, 0, sizeof(sum));
+    size_t threads = 0;
+    for (size_t i = 0; i < m_slots.size(); i++) {
+        const s_prof_counters &c = m_slots[i].counters;
+        bool isUsed = (c.eventsFiltered || c.lockAcquired);
+        for (size_t r = 0; r < PROF_ROUTINES_COUNT; r++) {
+            sum.calls[r] += c.calls[r];
+            sum.ticks[r] += c.ticks[r];
+            if (c.calls[r]) isUsed = true;
+        }
+        sum.eventsLogged += c.eventsLogged;
+        sum.eventsFiltered += c.eventsFiltered;
+        sum.bytesWritten += c.bytesWritten;
+        sum.writerTicks += c.writerTicks;
+        sum.lockAcquired += c.lockAcquired;
+        sum.lockWaitTicks += c.lockWaitTicks;
+        if (isUsed) threads++;
+    }
+
+    std::ofstream file(fileName.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    file << std::dec;
+    file << "[total]" << std::endl;
+    file << "elapsed_ticks" << DELIMITER << elapsed << std::endl;
+    file << "threads" << DELIMITER << threads << std::endl;
+
+    file << "[routines]" << std::endl;
+    file << "routine" << DELIMITER << "calls" << DELIMITER << "ticks" << DELIMITER << "ticks_per_call" << std::endl;
+    for (size_t r = 0; r < PROF_ROUTINES_COUNT; r++) {
+        if (!sum.calls[r]) continue;
+        file << g_routineNames[r] << DELIMITER
+            << sum.calls[r] << DELIMITER
+            << sum.ticks[r] << DELIMITER
+            << (sum.ticks[r] / sum.calls[r])
+            << std::endl;
+    }
+
+    file << "[writer]" << std::endl;
+    file << "events_logged" << DELIMITER << sum.eventsLogged << std::endl;
+    file << "events_filtered" << DELIMITER << sum.eventsFiltered << std::endl;
+    file << "bytes_written" << DELIMITER << sum.bytesWritten << std::endl;
+    file << "writer_ticks" << DELIMITER << sum.writerTicks << std::endl;
+
+    file << "[lock]" << std::endl;
+    file << "acquired" << DELIMITER << sum.lockAcquired << std::endl;
+    file << "wait_ticks" << DELIMITER << sum.lockWaitTicks << std::endl;
+
+    file << "[code_cache]" << std::endl;
+    file << "code_mem_used" << DELIMITER << CODECACHE_CodeMemUsed() << std::endl;
+    file << "code_mem_reserved" << DELIMITER << CODECACHE_CodeMemReserved() << std::endl;
+    file << "cache_size_limit" << DELIMITER << CODECACHE_CacheSizeLimit() << std::endl;
+    file << "traces" << DELIMITER << CODECACHE_NumTracesInCache() << std::endl;
+    file << "exit_stubs" << DELIMITER << CODECACHE_NumExitStubsInCache() << std::endl;
+    file << "exit_stub_mem_used" << DELIMITER << CODECACHE_ExitStubMemUsed() << std::endl;
+
+    // where the time of the tool went: the routines include the writing and the waiting, so they are subtracted
+    const UINT64 instrumentTicks = sum.ticks[PROF_INSTRUMENT_INS] + sum.ticks[PROF_INSTRUMENT_TRACE];
+    UINT64 analysisTicks = 0;
+    for (size_t r = 0; r < PROF_ROUTINES_COUNT; r++) {
+        if (r == PROF_INSTRUMENT_INS || r == PROF_INSTRUMENT_TRACE) continue;
+        analysisTicks += sum.ticks[r];
+    }
+    const UINT64 overhead = sum.writerTicks + sum.lockWaitTicks;
+    const UINT64 lookupTicks = (analysisTicks > overhead) ? (analysisTicks - overhead) : 0;
+    const UINT64 toolTicks = instrumentTicks + analysisTicks;
+
+    file << "[split]" << std::endl;
+    file << "part" << DELIMITER << "ticks" << DELIMITER << "share" << std::endl;
+    writeShare(file, "instrumentation", instrumentTicks, toolTicks);
+    writeShare(file, "lookups", lookupTicks, toolTicks);
+    writeShare(file, "io", sum.writerTicks, toolTicks);
+    writeShare(file, "lock_wait", sum.lockWaitTicks, toolTicks);
+    file.close();
+    return true;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "pin.H"
+
+#include <string>
+#include <vector>
+
+#include "Util.h"
+
+// the threads with the higher IDs share the last slot: their counts are approximate
+#define PROF_THREADS_MAX 1024
+
+typedef enum {
+    PROF_TRANSITION = 0,
+    PROF_RDTSC,
+    PROF_CPUID,
+    PROF_RDTSC_ALTER,
+    PROF_FUNC_ARGS,
+    PROF_FUNC_RET,
+    PROF_SYSCALL,
+    PROF_MEM_ACCESS,
+    PROF_TAINTED_BRANCH,
+    PROF_SAMPLE,
+    PROF_IMAGE,
+    PROF_INSTRUMENT_INS,
+    PROF_INSTRUMENT_TRACE,
+    PROF_ROUTINES_COUNT
+} t_prof_routine;
+
+struct s_prof_counters {
+    UINT64 calls[PROF_ROUTINES_COUNT];
+    UINT64 ticks[PROF_ROUTINES_COUNT]; // spent inside the routine, including the writing and the waiting for the lock
+    UINT64 eventsLogged;
+    UINT64 eventsFiltered; // skipped by the baseline
+    UINT64 bytesWritten;
+    UINT64 writerTicks;
+    UINT64 lockAcquired;
+    UINT64 lockWaitTicks;
+};
+
+/**
+    Counters of the tool's own work: how many times each of the analysis routines was called, and how long it took,
+    how much was written, and how long the threads waited for the client lock. The times are in TSC ticks.
+    Each thread updates only its own slot, without any locking: the slots are summed up at exit.
+*/
+class SelfProfile
+{
+public:
+    SelfProfile()
+        : m_slots(PROF_THREADS_MAX), m_startTime(util::getTimestamp())
+    {
+        ::memset(&m_slots[0], 0, m_slots.size() * sizeof(s_slot));
+    }
+
+    void addCall(const THREADID tid, const t_prof_routine routine, const UINT64 ticks)
+    {
+        s_prof_counters &c = counters(tid);
+        c.calls[routine]++;
+        c.ticks[routine] += ticks;
+    }
+
+    void addWrite(const THREADID tid, const size_t bytes, const UINT64 ticks)
+    {
+        s_prof_counters &c = counters(tid);
+        c.eventsLogged++;
+        c.bytesWritten += bytes;
+        c.writerTicks += ticks;
+    }
+
+    void addFiltered(const THREADID tid)
+    {
+        counters(tid).eventsFiltered++;
+    }
+
+    void addLockWait(const THREADID tid, const UINT64 ticks)
+    {
+        s_prof_counters &c = counters(tid);
+        c.lockAcquired++;
+        c.lockWaitTicks += ticks;
+    }
+
+    /**
+        Sums up the counters of all the threads, and writes them along with the statistics of the code cache,
+        and the split of the time between the instrumentation, the analysis, the writing, and the waiting for the lock.
+    */
+    bool writeReport(const std::string &fileName) const;
+
+protected:
+    struct s_slot {
+        s_prof_counters counters;
+        char padding[64]; // keep the slots of the different threads on separate cache lines
+    };
+
+    s_prof_counters& counters(const THREADID tid)
+    {
+        return m_slots[(tid < PROF_THREADS_MAX) ? tid : (PROF_THREADS_MAX - 1)].counters;
+    }
+
+    std::vector<s_slot> m_slots;
+    UINT64 m_startTime;
+};
+
+/**
+    Measures the analysis routine for the time of its scope. Does nothing if the profile is not set.
+*/
+class ProfileScope
+{
+public:
+    ProfileScope(SelfProfile* profile, const t_prof_routine routine)
+        : m_profile(profile), m_routine(routine), m_start(0)
+    {
+        if (m_profile) {
+            m_start = util::getTimestamp();
+        }
+    }
+
+    ~ProfileScope()
+    {
+        if (m_profile) {
+            m_profile->addCall(PIN_ThreadId(), m_routine, util::getTimestamp() - m_start);
+        }
+    }
+
+protected:
+    SelfProfile* m_profile;
+    t_prof_routine m_routine;
+    UINT64 m_start;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "pin.H"
+
+#define SHADOW_STACK_MAX 512
+
+struct s_frame {
+    ADDRINT retAddr;  // where the call is going to return
+    ADDRINT stackPtr; // stack pointer at the moment of the call (before the return address was pushed)
+};
+
+/**
+    Per-thread stack of the calls executed from the watched code.
+    It is filled only by the instrumentation of the calls/rets, the real stack of the target is never walked.
+    The frames of the calls that returned out of the watched code (i.e. API calls) are dropped lazily,
+    by comparing the stack pointers.
+*/
+class ShadowStack
+{
+public:
+    ShadowStack()
+        : m_count(0), m_overflow(0)
+    {
+    }
+
+    void push(const ADDRINT retAddr, const ADDRINT stackPtr)
+    {
+        unwind(stackPtr);
+        if (m_count == SHADOW_STACK_MAX) {
+            // the frame won't be stored, only counted
+            m_overflow++;
+            return;
+        }
+        m_frames[m_count].retAddr = retAddr;
+        m_frames[m_count].stackPtr = stackPtr;
+        m_count++;
+    }
+
+    // called before the ret, when the stack pointer still points to the return address
+    void pop(const ADDRINT stackPtr)
+    {
+        if (m_overflow) {
+            m_overflow--;
+            return;
+        }
+        unwind(stackPtr + sizeof(ADDRINT));
+    }
+
+    // drop all the frames that already returned, judging by the current stack pointer
+    void unwind(const ADDRINT stackPtr)
+    {
+        if (m_count == 0) {
+            return;
+        }
+        if (m_overflow && stackPtr >= m_frames[m_count - 1].stackPtr) {
+            // all the frames that were not stored must have returned
+            m_overflow = 0;
+        }
+        while (m_count > 0 && m_frames[m_count - 1].stackPtr <= stackPtr) {
+            m_count--;
+        }
+    }
+
+    size_t depth() const
+    {
+        return m_count + m_overflow;
+    }
+
+    // the number of the frames that can be retrieved
+    size_t stored() const
+    {
+        return m_count;
+    }
+
+    // get the frame by its index, counting from the top
+    const s_frame* getFrame(size_t index) const
+    {
+        if (index >= m_count) {
+            return NULL;
+        }
+        return &m_frames[m_count - 1 - index];
+    }
+
+protected:
+    s_frame m_frames[SHADOW_STACK_MAX];
+    size_t m_count;
+    size_t m_overflow;
+};
@@ -0,0 +1,300 @@
+#include "SyscallsTable.h"
+
+// Syscall numbers of the NT kernel service table (x64, also valid for WoW64 after masking).
+// Only the low part of the table is included: it is the most frequently used one.
+// The numbers may change between the builds: each table is used only on the builds listed in g_knownBuilds.
+
+const s_syscall g_syscallsWin7[] = {
+    { 0x00, "NtMapUserPhysicalPagesScatter", 3 },
+    { 0x01, "NtWaitForSingleObject", 3 },
+    { 0x02, "NtCallbackReturn", 3 },
+    { 0x03, "NtReadFile", 9 },
+    { 0x04, "NtDeviceIoControlFile", 10 },
+    { 0x05, "NtWriteFile", 9 },
+    { 0x06, "NtRemoveIoCompletion", 5 },
+    { 0x07, "NtReleaseSemaphore", 3 },
+    { 0x08, "NtReplyWaitReceivePort", 4 },
+    { 0x09, "NtReplyPort", 2 },
+    { 0x0a, "NtSetInformationThread", 4 },
+    { 0x0b, "NtSetEvent", 2 },
+    { 0x0c, "NtClose", 1 },
+    { 0x0d, "NtQueryObject", 5 },
+    { 0x0e, "NtQueryInformationFile", 5 },
+    { 0x0f, "NtOpenKey", 3 },
+    { 0x10, "NtEnumerateValueKey", 6 },
+    { 0x11, "NtFindAtom", 3 },
+    { 0x12, "NtQueryDefaultLocale", 2 },
+    { 0x13, "NtQueryKey", 5 },
+    { 0x14, "NtQueryValueKey", 6 },
+    { 0x15, "NtAllocateVirtualMemory", 6 },
+    { 0x16, "NtQueryInformationProcess", 5 },
+    { 0x17, "NtWaitForMultipleObjects32", 5 },
+    { 0x18, "NtWriteFileGather", 9 },
+    { 0x19, "NtSetInformationProcess", 4 },
+    { 0x1a, "NtCreateKey", 7 },
+    { 0x1b, "NtFreeVirtualMemory", 4 },
+    { 0x1c, "NtImpersonateClientOfPort", 2 },
+    { 0x1d, "NtReleaseMutant", 2 },
+    { 0x1e, "NtQueryInformationToken", 5 },
+    { 0x1f, "NtRequestWaitReplyPort", 3 },
+    { 0x20, "NtQueryVirtualMemory", 6 },
+    { 0x21, "NtOpenThreadToken", 4 },
+    { 0x22, "NtQueryInformationThread", 5 },
+    { 0x23, "NtOpenProcess", 4 },
+    { 0x24, "NtSetInformationFile", 5 },
+    { 0x25, "NtMapViewOfSection", 10 },
+    { 0x26, "NtAccessCheckAndAuditAlarm", 11 },
+    { 0x27, "NtUnmapViewOfSection", 2 },
+    { 0x28, "NtReplyWaitReceivePortEx", 5 },
+    { 0x29, "NtTerminateProcess", 2 },
+    { 0x2a, "NtSetEventBoostPriority", 1 },
+    { 0x2b, "NtReadFileScatter", 9 },
+    { 0x2c, "NtOpenThreadTokenEx", 5 },
+    { 0x2d, "NtOpenProcessTokenEx", 4 },
+    { 0x2e, "NtQueryPerformanceCounter", 2 },
+    { 0x2f, "NtEnumerateKey", 6 },
+    { 0x30, "NtOpenFile", 6 },
+    { 0x31, "NtDelayExecution", 2 },
+    { 0x32, "NtQueryDirectoryFile", 11 },
+    { 0x33, "NtQuerySystemInformation", 4 },
+    { 0x34, "NtOpenSection", 3 },
+    { 0x35, "NtQueryTimer", 5 },
+    { 0x36, "NtFsControlFile", 10 },
+    { 0x37, "NtWriteVirtualMemory", 5 },
+    { 0x38, "NtCloseObjectAuditAlarm", 3 },
+    { 0x39, "NtDuplicateObject", 7 },
+    { 0x3a, "NtQueryAttributesFile", 2 },
+    { 0x3b, "NtClearEvent", 1 },
+    { 0x3c, "NtReadVirtualMemory", 5 },
+    { 0x3d, "NtOpenEvent", 3 },
+    { 0x3e, "NtAdjustPrivilegesToken", 6 },
+    { 0x3f, "NtDuplicateToken", 6 },
+    { 0x40, "NtContinue", 2 },
+    { 0x41, "NtQueryDefaultUILanguage", 1 },
+    { 0x42, "NtQueueApcThread", 5 },
+    { 0x43, "NtYieldExecution", 0 },
+    { 0x44, "NtAddAtom", 3 },
+    { 0x45, "NtCreateEvent", 5 },
+    { 0x46, "NtQueryVolumeInformationFile", 5 },
+    { 0x47, "NtCreateSection", 7 },
+    { 0x48, "NtFlushBuffersFile", 2 },
+    { 0x49, "NtApphelpCacheControl", 2 },
+    { 0x4a, "NtCreateProcessEx", 9 },
+    { 0x4b, "NtCreateThread", 8 },
+    { 0x4c, "NtIsProcessInJob", 2 },
+    { 0x4d, "NtProtectVirtualMemory", 5 },
+    { 0x4e, "NtQuerySection", 5 },
+    { 0x4f, "NtResumeThread", 2 },
+    { 0x50, "NtTerminateThread", 2 },
+    { 0x51, "NtReadRequestData", 6 },
+    { 0x52, "NtCreateFile", 11 },
+    { 0x53, "NtQueryEvent", 5 },
+    { 0x54, "NtWriteRequestData", 6 },
+    { 0x55, "NtOpenDirectoryObject", 3 },
+    { 0x56, "NtAccessCheckByTypeAndAuditAlarm", 16 },
+    { 0x57, "NtQuerySystemTime", 1 },
+    { 0x58, "NtWaitForMultipleObjects", 5 },
+    { 0x59, "NtSetInformationObject", 4 },
+    { 0x5a, "NtCancelIoFile", 2 },
+    { 0x5b, "NtTraceEvent", 4 },
+    { 0x5c, "NtPowerInformation", 5 },
+    { 0x5d, "NtSetValueKey", 6 },
+    { 0x5e, "NtCancelTimer", 2 },
+    { 0x5f, "NtSetTimer", 7 },
+};
+
+const s_syscall g_syscallsWin10[] = {
+    { 0x00, "NtAccessCheck", 8 },
+    { 0x01, "NtWorkerFactoryWorkerReady", 1 },
+    { 0x02, "NtAcceptConnectPort", 6 },
+    { 0x03, "NtMapUserPhysicalPagesScatter", 3 },
+    { 0x04, "NtWaitForSingleObject", 3 },
+    { 0x05, "NtCallbackReturn", 3 },
+    { 0x06, "NtReadFile", 9 },
+    { 0x07, "NtDeviceIoControlFile", 10 },
+    { 0x08, "NtWriteFile", 9 },
+    { 0x09, "NtRemoveIoCompletion", 5 },
+    { 0x0a, "NtReleaseSemaphore", 3 },
+    { 0x0b, "NtReplyWaitReceivePort", 4 },
+    { 0x0c, "NtReplyPort", 2 },
+    { 0x0d, "NtSetInformationThread", 4 },
+    { 0x0e, "NtSetEvent", 2 },
+    { 0x0f, "NtClose", 1 },
+    { 0x10, "NtQueryObject", 5 },
+    { 0x11, "NtQueryInformationFile", 5 },
+    { 0x12, "NtOpenKey", 3 },
+    { 0x13, "NtEnumerateValueKey", 6 },
+    { 0x14, "NtFindAtom", 3 },
+    { 0x15, "NtQueryDefaultLocale", 2 },
+    { 0x16, "NtQueryKey", 5 },
+    { 0x17, "NtQueryValueKey", 6 },
+    { 0x18, "NtAllocateVirtualMemory", 6 },
+    { 0x19, "NtQueryInformationProcess", 5 },
+    { 0x1a, "NtWaitForMultipleObjects32", 5 },
+    { 0x1b, "NtWriteFileGather", 9 },
+    { 0x1c, "NtSetInformationProcess", 4 },
+    { 0x1d, "NtCreateKey", 7 },
+    { 0x1e, "NtFreeVirtualMemory", 4 },
+    { 0x1f, "NtImpersonateClientOfPort", 2 },
+    { 0x20, "NtReleaseMutant", 2 },
+    { 0x21, "NtQueryInformationToken", 5 },
+    { 0x22, "NtRequestWaitReplyPort", 3 },
+    { 0x23, "NtQueryVirtualMemory", 6 },
+    { 0x24, "NtOpenThreadToken", 4 },
+    { 0x25, "NtQueryInformationThread", 5 },
+    { 0x26, "NtOpenProcess", 4 },
+    { 0x27, "NtSetInformationFile", 5 },
+    { 0x28, "NtMapViewOfSection", 10 },
+    { 0x29, "NtAccessCheckAndAuditAlarm", 11 },
+    { 0x2a, "NtUnmapViewOfSection", 2 },
+    { 0x2b, "NtReplyWaitReceivePortEx", 5 },
+    { 0x2c, "NtTerminateProcess", 2 },
+    { 0x2d, "NtSetEventBoostPriority", 1 },
+    { 0x2e, "NtReadFileScatter", 9 },
+    { 0x2f, "NtOpenThreadTokenEx", 5 },
+    { 0x30, "NtOpenProcessTokenEx", 4 },
+    { 0x31, "NtQueryPerformanceCounter", 2 },
+    { 0x32, "NtEnumerateKey", 6 },
+    { 0x33, "NtOpenFile", 6 },
+    { 0x34, "NtDelayExecution", 2 },
+    { 0x35, "NtQueryDirectoryFile", 11 },
+    { 0x36, "NtQuerySystemInformation", 4 },
+    { 0x37, "NtOpenSection", 3 },
+    { 0x38, "NtQueryTimer", 5 },
+    { 0x39, "NtFsControlFile", 10 },
+    { 0x3a, "NtWriteVirtualMemory", 5 },
+    { 0x3b, "NtCloseObjectAuditAlarm", 3 },
+    { 0x3c, "NtDuplicateObject", 7 },
+    { 0x3d, "NtQueryAttributesFile", 2 },
+    { 0x3e, "NtClearEvent", 1 },
+    { 0x3f, "NtReadVirtualMemory", 5 },
+    { 0x40, "NtOpenEvent", 3 },
+    { 0x41, "NtAdjustPrivilegesToken", 6 },
+    { 0x42, "NtDuplicateToken", 6 },
+    { 0x43, "NtContinue", 2 },
+    { 0x44, "NtQueryDefaultUILanguage", 1 },
+    { 0x45, "NtQueueApcThread", 5 },
+    { 0x46, "NtYieldExecution", 0 },
+    { 0x47, "NtAddAtom", 3 },
+    { 0x48, "NtCreateEvent", 5 },
+    { 0x49, "NtQueryVolumeInformationFile", 5 },
+    { 0x4a, "NtCreateSection", 7 },
+    { 0x4b, "NtFlushBuffersFile", 2 },
+    { 0x4c, "NtApphelpCacheControl", 2 },
+    { 0x4d, "NtCreateProcessEx", 9 },
+    { 0x4e, "NtCreateThread", 8 },
+    { 0x4f, "NtIsProcessInJob", 2 },
+    { 0x50, "NtProtectVirtualMemory", 5 },
+    { 0x51, "NtQuerySection", 5 },
+    { 0x52, "NtResumeThread", 2 },
+    { 0x53, "NtTerminateThread", 2 },
+    { 0x54, "NtReadRequestData", 6 },
+    { 0x55, "NtCreateFile", 11 },
+    { 0x56, "NtQueryEvent", 5 },
+    { 0x57, "NtWriteRequestData", 6 },
+    { 0x58, "NtOpenDirectoryObject", 3 },
+    { 0x59, "NtAccessCheckByTypeAndAuditAlarm", 16 },
+    { 0x5a, "NtQuerySystemTime", 1 },
+    { 0x5b, "NtWaitForMultipleObjects", 5 },
+    { 0x5c, "NtSetInformationObject", 4 },
+    { 0x5d, "NtCancelIoFile", 2 },
+    { 0x5e, "NtTraceEvent", 4 },
+    { 0x5f, "NtPowerInformation", 5 },
+    { 0x60, "NtSetValueKey", 6 },
+    { 0x61, "NtCancelTimer", 2 },
+    { 0x62, "NtSetTimer", 7 },
+};
+
+//---
+
+#define ARRAY_LEN(arr) (sizeof(arr) / sizeof(arr[0]))
+
+struct s_os_build {
+    UINT32 build;
+    const s_syscall* table;
+    size_t tableSize;
+};
+
+// The builds on which the numbers of the table were verified. The numbers may be changed by any new build,
+// so on the builds that are not listed the names are not resolved.
+const s_os_build g_knownBuilds[] = {
+    { 7600, g_syscallsWin7, ARRAY_LEN(g_syscallsWin7) }, // Win 7
+    { 7601, g_syscallsWin7, ARRAY_LEN(g_syscallsWin7) }, // Win 7 SP1
+    { 10240, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 1507
+    { 10586, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 1511
+    { 14393, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 1607
+    { 15063, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 1703
+    { 16299, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 1709
+    { 17134, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 1803
+    { 17763, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 1809
+    { 18362, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 1903
+    { 18363, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 1909
+    { 19041, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 2004
+    { 19042, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 20H2
+    { 19043, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 21H1
+    { 19044, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 21H2
+    { 19045, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 10 22H2
+    { 22000, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 11 21H2
+    { 22621, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 11 22H2
+    { 22631, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 11 23H2
+    { 26100, g_syscallsWin10, ARRAY_LEN(g_syscallsWin10) }, // Win 11 24H2
+};
+
+// the table selected for the running OS:
+static const s_syscall* g_Table = NULL;
+static size_t g_TableSize = 0;
+
+// fields of KUSER_SHARED_DATA, mapped at the same address in every process
+#define KUSER_SHARED_DATA_ADDR 0x7FFE0000
+#define KUSER_NT_BUILD_NUMBER 0x260 // filled since Win 10
+#define KUSER_NT_MAJOR_VERSION 0x26C
+#define KUSER_NT_MINOR_VERSION 0x270
+
+#define WIN7_BUILD_SP1 7601
+
+bool syscalls::init()
+{
+#ifdef TARGET_WINDOWS
+    UINT32 major = 0;
+    UINT32 minor = 0;
+    if (PIN_SafeCopy(&major, (VOID*)(KUSER_SHARED_DATA_ADDR + KUSER_NT_MAJOR_VERSION), sizeof(major)) != sizeof(major)
+        || PIN_SafeCopy(&minor, (VOID*)(KUSER_SHARED_DATA_ADDR + KUSER_NT_MINOR_VERSION), sizeof(minor)) != sizeof(minor))
+    {
+        return false;
+    }
+    UINT32 build = 0;
+    if (major == 6 && minor == 1) {
+        // the build number is not stored in KUSER_SHARED_DATA, but the numbers did not change with SP1
+        build = WIN7_BUILD_SP1;
+    }
+    else if (major == 10) {
+        if (PIN_SafeCopy(&build, (VOID*)(KUSER_SHARED_DATA_ADDR + KUSER_NT_BUILD_NUMBER), sizeof(build)) != sizeof(build)) {
+            return false;
+        }
+        build &= 0xFFFF; // the higher bits may contain the flags of the build
+    }
+    for (size_t i = 0; i < ARRAY_LEN(g_knownBuilds); i++) {
+        if (g_knownBuilds[i].build == build) {
+            g_Table = g_knownBuilds[i].table;
+            g_TableSize = g_knownBuilds[i].tableSize;
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+const s_syscall* syscalls::find(ADDRINT number)
+{
+    // on WoW64 the higher bits may be used as the index of the argument conversion routine
+    const ADDRINT index = number & SYSCALL_NUMBER_MASK;
+    if (!g_Table || index >= g_TableSize) {
+        return NULL;
+    }
+    // the tables are indexed by the syscall number
+    const s_syscall* sys = &g_Table[index];
+    if (sys->number != index) {
+        return NULL;
+    }
+    return sys;
+}
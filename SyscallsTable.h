@@ -0,0 +1,26 @@
+#pragma once
+
+#include "pin.H"
+
+#define SYSCALL_NUMBER_MASK 0x0FFF
+
+struct s_syscall {
+    UINT32 number;
+    const char* name;
+    UINT32 argsCount;
+};
+
+namespace syscalls {
+
+    /**
+        Selects the syscalls table matching the running OS.
+        \return : true if the OS is supported, false otherwise
+    */
+    bool init();
+
+    /**
+        Finds the syscall with the given number in the selected table.
+        \return : the syscall description, or NULL if it is unknown
+    */
+    const s_syscall* find(ADDRINT number);
+};
@@ -0,0 +1,138 @@
+#include "Taint.h"
+
+namespace taint {
+
+    const REG g_TrackedRegs[TAINT_REGS_COUNT] = {
+        REG_GAX, REG_GBX, REG_GCX, REG_GDX, REG_GSI, REG_GDI, REG_GBP,
+#ifdef TARGET_IA32E
+        REG_R8, REG_R9, REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15,
+#else
+        REG_INVALID(), REG_INVALID(), REG_INVALID(), REG_INVALID(), REG_INVALID(), REG_INVALID(), REG_INVALID(), REG_INVALID(),
+#endif
+        REG_INVALID()
+    };
+
+};
+
+int taint::regToIndex(REG reg)
+{
+    if (!REG_valid(reg)) {
+        return TAINT_REG_NONE;
+    }
+    const REG fullReg = REG_FullRegName(reg);
+    for (int i = 0; i < TAINT_REGS_COUNT; i++) {
+        if (g_TrackedRegs[i] == fullReg) {
+            return i;
+        }
+    }
+    return TAINT_REG_NONE;
+}
+
+UINT32 taint::regToMask(REG reg)
+{
+    if (REG_valid(reg) && REG_is_flags(reg)) {
+        return TAINT_FLAGS_BIT;
+    }
+    const int index = regToIndex(reg);
+    if (index == TAINT_REG_NONE) {
+        return 0;
+    }
+    return UINT32(1) << index;
+}
+
+UINT32 taint::volatileRegsMask()
+{
+    UINT32 mask = TAINT_FLAGS_BIT;
+    mask |= regToMask(REG_GAX) | regToMask(REG_GCX) | regToMask(REG_GDX);
+#ifdef TARGET_IA32E
+    mask |= regToMask(REG_R8) | regToMask(REG_R9) | regToMask(REG_R10) | regToMask(REG_R11);
+#endif
+    return mask;
+}
+
+//---
+
+ShadowMemory::~ShadowMemory()
+{
+    for (size_t i = 0; i < SHADOW_DIR_SIZE; i++) {
+        UINT8** table = m_dir[i];
+        if (!table) continue;
+        for (size_t k = 0; k < SHADOW_TABLE_SIZE; k++) {
+            delete[] table[k];
+        }
+        delete[] table;
+    }
+}
+
+UINT8* ShadowMemory::getPage(const ADDRINT addr) const
+{
+    const UINT64 pageNum = UINT64(addr) >> SHADOW_PAGE_BITS;
+    UINT8** table = m_dir[(pageNum >> SHADOW_TABLE_BITS) % SHADOW_DIR_SIZE];
+    if (!table) {
+        return NULL;
+    }
+    return table[pageNum & (SHADOW_TABLE_SIZE - 1)];
+}
+
+UINT8* ShadowMemory::allocPage(const ADDRINT addr)
+{
+    const UINT64 pageNum = UINT64(addr) >> SHADOW_PAGE_BITS;
+    const size_t dirIndex = (size_t)((pageNum >> SHADOW_TABLE_BITS) % SHADOW_DIR_SIZE);
+    const size_t tableIndex = (size_t)(pageNum & (SHADOW_TABLE_SIZE - 1));
+
+    PIN_GetLock(&m_lock, 1);
+    UINT8** table = m_dir[dirIndex];
+    if (!table) {
+        table = new UINT8*[SHADOW_TABLE_SIZE];
+        ::memset(table, 0, SHADOW_TABLE_SIZE * sizeof(UINT8*));
+        m_dir[dirIndex] = table;
+    }
+    UINT8* page = table[tableIndex];
+    if (!page) {
+        page = new UINT8[SHADOW_PAGE_SIZE];
+        ::memset(page, TAINT_CLEAN, SHADOW_PAGE_SIZE);
+        table[tableIndex] = page;
+    }
+    PIN_ReleaseLock(&m_lock);
+    return page;
+}
+
+UINT8 ShadowMemory::get(const ADDRINT addr, const UINT32 size) const
+{
+    for (UINT32 i = 0; i < size; ) {
+        const ADDRINT curr = addr + i;
+        const size_t offset = curr & (SHADOW_PAGE_SIZE - 1);
+        const UINT8* page = getPage(curr);
+        const size_t inPage = SHADOW_PAGE_SIZE - offset;
+        const size_t toCheck = (size - i < inPage) ? (size - i) : inPage;
+        if (page) {
+            for (size_t k = 0; k < toCheck; k++) {
+                if (page[offset + k] != TAINT_CLEAN) {
+                    return page[offset + k];
+                }
+            }
+        }
+        i += (UINT32)toCheck;
+    }
+    return TAINT_CLEAN;
+}
+
+void ShadowMemory::set(const ADDRINT addr, const size_t size, const UINT8 label)
+{
+    for (size_t i = 0; i < size; ) {
+        const ADDRINT curr = addr + i;
+        const size_t offset = curr & (SHADOW_PAGE_SIZE - 1);
+        const size_t inPage = SHADOW_PAGE_SIZE - offset;
+        const size_t toSet = (size - i < inPage) ? (size - i) : inPage;
+
+        UINT8* page = getPage(curr);
+        if (!page && label != TAINT_CLEAN) {
+            page = allocPage(curr);
+        }
+        // cleaning the memory that was never tainted needs no page
+        if (page) {
+            ::memset(page + offset, label, toSet);
+        }
+        i += toSet;
+    }
+}
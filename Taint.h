@@ -0,0 +1,112 @@
+#pragma once
+
+#include "pin.H"
+
+#define TAINT_CLEAN 0
+#define TAINT_LABEL_MAX 0xFF
+
+#define TAINT_REGS_COUNT 16
+#define TAINT_REG_NONE (-1)
+#define TAINT_FLAGS_BIT (UINT32(1) << 31)
+
+#define SHADOW_PAGE_BITS 12
+#define SHADOW_PAGE_SIZE (1 << SHADOW_PAGE_BITS)
+#define SHADOW_TABLE_BITS 20 // pages covered by one table (4 GB)
+#define SHADOW_TABLE_SIZE (1 << SHADOW_TABLE_BITS)
+#define SHADOW_DIR_SIZE 0x10000
+
+namespace taint {
+
+    // the index of the tracked register (only the general purpose ones are tracked)
+    int regToIndex(REG reg);
+
+    // the mask of the tracked register, including the flags
+    UINT32 regToMask(REG reg);
+
+    // the mask of the registers that are not preserved by the called functions
+    UINT32 volatileRegsMask();
+};
+
+/**
+    The labels of the registers of a single thread.
+    A label is the id of the source from which the value was derived (TAINT_CLEAN if none).
+*/
+struct s_taint_regs {
+    UINT8 regs[TAINT_REGS_COUNT];
+    UINT8 flags;
+
+    s_taint_regs()
+        : flags(TAINT_CLEAN)
+    {
+        ::memset(regs, TAINT_CLEAN, sizeof(regs));
+    }
+
+    // the label of the first tainted register from the mask
+    UINT8 getLabel(const UINT32 mask) const
+    {
+        if ((mask & TAINT_FLAGS_BIT) && flags != TAINT_CLEAN) {
+            return flags;
+        }
+        for (size_t i = 0; i < TAINT_REGS_COUNT; i++) {
+            if ((mask & (UINT32(1) << i)) && regs[i] != TAINT_CLEAN) {
+                return regs[i];
+            }
+        }
+        return TAINT_CLEAN;
+    }
+
+    void setLabel(const UINT32 mask, const UINT8 label)
+    {
+        if (mask & TAINT_FLAGS_BIT) {
+            flags = label;
+        }
+        for (size_t i = 0; i < TAINT_REGS_COUNT; i++) {
+            if (mask & (UINT32(1) << i)) {
+                regs[i] = label;
+            }
+        }
+    }
+};
+
+/**
+    Byte-granular labels of the memory. Two-level: a directory of the tables, each covering 4 GB,
+    pointing to the pages of the labels. Both are allocated only when something gets tainted,
+    so the reads of the clean memory stop at the first missing level.
+    The lookups are lock-free, only the allocation is synchronized.
+*/
+class ShadowMemory
+{
+public:
+    ShadowMemory()
+        : m_isActive(false)
+    {
+        ::memset(m_dir, 0, sizeof(m_dir));
+        PIN_InitLock(&m_lock);
+    }
+
+    ~ShadowMemory();
+
+    // the label of the first tainted byte within the range
+    UINT8 get(const ADDRINT addr, const UINT32 size) const;
+
+    void set(const ADDRINT addr, const size_t size, const UINT8 label);
+
+    // has anything been tainted so far (once set, it stays set)
+    bool isActive() const
+    {
+        return m_isActive;
+    }
+
+    void activate()
+    {
+        m_isActive = true;
+    }
+
+protected:
+    UINT8* getPage(const ADDRINT addr) const;
+    UINT8* allocPage(const ADDRINT addr);
+
+    UINT8** m_dir[SHADOW_DIR_SIZE];
+    PIN_LOCK m_lock;
+    volatile bool m_isActive;
+};
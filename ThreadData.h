@@ -0,0 +1,104 @@
+#pragma once
+
+#include "pin.H"
+#include "ShadowStack.h"
+#include "LatencyStats.h"
+#include "CallGraph.h"
+#include "ApiFingerprint.h"
+#include "BranchTrace.h"
+#include "MemWatch.h"
+#include "Taint.h"
+#include "ModuleMatrix.h"
+
+#define SYSCALL_ARGS_MAX 16
+#define WATCHED_ARGS_MAX 10
+#define PENDING_CALLS_MAX 16
+
+struct s_syscall_info {
+    ADDRINT armed; // address of the watched syscall instruction that is about to be executed
+    ADDRINT address; // address of the syscall instruction, issued from the watched code
+    ADDRINT number;
+    ADDRINT args[SYSCALL_ARGS_MAX];
+    size_t argsCount;
+    bool isPending; // the arguments are saved, waiting for the return value
+};
+
+// a call to the watched function, waiting for its return
+struct s_pending_call {
+    UINT32 funcId;
+    ADDRINT retAddr;
+    ADDRINT stackPtr; // stack pointer at the function entry (pointing to the return address)
+    ADDRINT args[WATCHED_ARGS_MAX];
+    UINT64 startTime; // tool-side timestamp of the function entry
+};
+
+/**
+    Data private to each of the application threads.
+    Allocated once at the thread start, so that the analysis routines never need to allocate.
+*/
+class ThreadData
+{
+public:
+    ThreadData()
+        : pendingCount(0), sampleCountdown(0), latency(NULL), edges(NULL), ngrams(NULL), branches(NULL), memAccess(NULL), taint(NULL), transitions(NULL)
+    {
+        ::memset(&syscall, 0, sizeof(syscall));
+    }
+
+    ~ThreadData()
+    {
+        delete latency;
+        delete edges;
+        delete ngrams;
+        delete branches;
+        delete memAccess;
+        delete taint;
+        delete transitions;
+    }
+
+    bool pushPendingCall(const s_pending_call &call)
+    {
+        if (pendingCount == PENDING_CALLS_MAX) {
+            return false;
+        }
+        pendingCalls[pendingCount++] = call;
+        return true;
+    }
+
+    /**
+        Finds the call that is returning, judging by the stack pointer.
+        The calls that were left without returning (i.e. by an exception) are dropped.
+    */
+    bool popPendingCall(const UINT32 funcId, const ADDRINT stackPtr, s_pending_call &call)
+    {
+        while (pendingCount > 0 && pendingCalls[pendingCount - 1].stackPtr < stackPtr) {
+            pendingCount--;
+        }
+        if (pendingCount == 0) {
+            return false;
+        }
+        const s_pending_call &top = pendingCalls[pendingCount - 1];
+        if (top.stackPtr != stackPtr || top.funcId != funcId) {
+            return false;
+        }
+        call = top;
+        pendingCount--;
+        return true;
+    }
+
+    s_syscall_info syscall;
+    ShadowStack stack;
+
+    s_pending_call pendingCalls[PENDING_CALLS_MAX];
+    size_t pendingCount;
+
+    INT64 sampleCountdown; // instructions left till the next sample
+
+    LatencyStats* latency; // durations of the watched functions, allocated only if requested
+    EdgeTable* edges; // shard of the call graph, allocated only if requested
+    NgramCounter* ngrams; // n-grams of the API calls, allocated only if requested
+    BranchBuffer* branches; // packets of the branch trace, allocated only if requested
+    MemAccessBuffer* memAccess; // accesses to the watched memory, waiting to be logged, allocated only if requested
+    s_taint_regs* taint; // labels of the registers, allocated only if requested
+    TransitionMatrix* transitions; // transitions between the modules, allocated at the first one
+};
@@ -0,0 +1,146 @@
+#include "TimelineLog.h"
+
+#include <iomanip>
+
+#include "Util.h"
+
+#define CALIBRATION_MS 20
+
+static const char* g_counterNames[COUNTERS_COUNT] = { "RDTSC", "CPUID" };
+
+bool TimelineLog::init(const std::string &fileName)
+{
+    m_file.open(fileName.c_str());
+    if (!m_file.is_open()) {
+        return false;
+    }
+    m_pid = PIN_GetPid();
+
+    // calibrate the clock of the tool
+    const UINT64 start = util::getTimestamp();
+    PIN_Sleep(CALIBRATION_MS);
+    const UINT64 end = util::getTimestamp();
+    if (end > start) {
+        m_ticksPerUs = double(end - start) / (CALIBRATION_MS * 1000);
+    }
+    m_startTime = util::getTimestamp();
+
+    m_file << "[";
+    m_file << std::fixed << std::setprecision(3);
+    return true;
+}
+
+double TimelineLog::getTimestampUs() const
+{
+    return double(util::getTimestamp() - m_startTime) / m_ticksPerUs;
+}
+
+std::string TimelineLog::escapeStr(const std::string &str)
+{
+    std::string out;
+    for (size_t i = 0; i < str.length(); i++) {
+        const char c = str[i];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+void TimelineLog::beginEvent(const char* phase, const THREADID tid, const double ts)
+{
+    m_file << (m_isFirst ? "\n" : ",\n")
+        << "{\"ph\":\"" << phase << "\",\"pid\":" << std::dec << m_pid << ",\"tid\":" << tid
+        << ",\"ts\":" << ts;
+    m_isFirst = false;
+}
+
+TimelineLog::s_track& TimelineLog::getTrack(const THREADID tid)
+{
+    std::map<THREADID, s_track>::iterator itr = m_tracks.find(tid);
+    if (itr != m_tracks.end()) {
+        return itr->second;
+    }
+    s_track &track = m_tracks[tid];
+    ::memset(track.counters, 0, sizeof(track.counters));
+
+    // name the track of the new thread
+    beginEvent("M", tid, 0);
+    m_file << ",\"name\":\"thread_name\",\"args\":{\"name\":\"thread " << std::dec << tid << "\"}}";
+    return track;
+}
+
+void TimelineLog::logSection(const THREADID tid, const std::string &name)
+{
+    if (!m_file.is_open()) return;
+
+    s_track &track = getTrack(tid);
+    const double ts = getTimestampUs();
+    if (track.section.length()) {
+        beginEvent("E", tid, ts);
+        m_file << "}";
+    }
+    beginEvent("B", tid, ts);
+    m_file << ",\"cat\":\"section\",\"name\":\"" << escapeStr(name) << "\"}";
+    track.section = name;
+}
+
+void TimelineLog::logCall(const THREADID tid, const std::string &name, const ADDRINT base, const ADDRINT rva)
+{
+    if (!m_file.is_open()) return;
+
+    getTrack(tid);
+    beginEvent("i", tid, getTimestampUs());
+    m_file << ",\"s\":\"t\",\"cat\":\"call\",\"name\":\"" << escapeStr(name) << "\""
+        << ",\"args\":{\"from\":\"";
+    if (base) {
+        m_file << std::hex << base << "+";
+    }
+    m_file << std::hex << rva << "\"}}";
+}
+
+void TimelineLog::writeCounter(const THREADID tid, const t_counter_type type, s_counter &counter, const double ts)
+{
+    beginEvent("C", tid, ts);
+    m_file << ",\"name\":\"" << g_counterNames[type] << " (thread " << std::dec << tid << ")\""
+        << ",\"args\":{\"count\":" << counter.count << "}}";
+    counter.emitted = counter.count;
+    counter.lastTs = ts;
+}
+
+void TimelineLog::logCounter(const THREADID tid, const t_counter_type type)
+{
+    if (!m_file.is_open() || type >= COUNTERS_COUNT) return;
+
+    s_counter &counter = getTrack(tid).counters[type];
+    counter.count++;
+
+    // a burst is saved as a single sample per interval
+    const double ts = getTimestampUs();
+    if (counter.emitted == 0 || (ts - counter.lastTs) >= COUNTER_INTERVAL_US) {
+        writeCounter(tid, type, counter, ts);
+    }
+}
+
+void TimelineLog::close()
+{
+    if (!m_file.is_open()) return;
+
+    const double ts = getTimestampUs();
+    for (std::map<THREADID, s_track>::iterator itr = m_tracks.begin(); itr != m_tracks.end(); ++itr) {
+        s_track &track = itr->second;
+        for (size_t i = 0; i < COUNTERS_COUNT; i++) {
+            if (track.counters[i].count != track.counters[i].emitted) {
+                writeCounter(itr->first, (t_counter_type)i, track.counters[i], ts);
+            }
+        }
+        if (track.section.length()) {
+            beginEvent("E", itr->first, ts);
+            m_file << "}";
+            track.section.clear();
+        }
+    }
+    m_file << "\n]\n";
+    m_file.close();
+}
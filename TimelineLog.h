@@ -0,0 +1,72 @@
+#pragma once
+
+#include "pin.H"
+
+#include <fstream>
+#include <map>
+#include <string>
+
+#define COUNTER_INTERVAL_US 1000.0
+
+typedef enum {
+    COUNTER_RDTSC = 0,
+    COUNTER_CPUID,
+    COUNTERS_COUNT
+} t_counter_type;
+
+/**
+    Writes the events in the Chrome Trace Event format (JSON Array), that can be opened by chrome://tracing or Perfetto.
+    Each thread gets its own track: the sections are slices, the API calls are instant events,
+    and the RDTSC/CPUID executions are counters.
+    The events are streamed to the file, so the memory used stays constant.
+*/
+class TimelineLog
+{
+public:
+    TimelineLog()
+        : m_pid(0), m_startTime(0), m_ticksPerUs(1.0), m_isFirst(true)
+    {
+    }
+
+    ~TimelineLog()
+    {
+        close();
+    }
+
+    bool init(const std::string &fileName);
+
+    void logSection(const THREADID tid, const std::string &name);
+    void logCall(const THREADID tid, const std::string &name, const ADDRINT base, const ADDRINT rva);
+    void logCounter(const THREADID tid, const t_counter_type type);
+
+    // close all the open slices, save the last values of the counters
+    void close();
+
+protected:
+    struct s_counter {
+        UINT64 count;
+        UINT64 emitted; // the last saved value
+        double lastTs;
+    };
+
+    struct s_track {
+        std::string section; // the currently open slice
+        s_counter counters[COUNTERS_COUNT];
+    };
+
+    double getTimestampUs() const;
+
+    s_track& getTrack(const THREADID tid);
+
+    void beginEvent(const char* phase, const THREADID tid, const double ts);
+    void writeCounter(const THREADID tid, const t_counter_type type, s_counter &counter, const double ts);
+
+    static std::string escapeStr(const std::string &str);
+
+    std::ofstream m_file;
+    std::map<THREADID, s_track> m_tracks;
+    INT m_pid;
+    UINT64 m_startTime;
+    double m_ticksPerUs;
+    bool m_isFirst;
+};
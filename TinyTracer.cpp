@@ -5,12 +5,14 @@
 * Prints to <output_file> addresses of transitions from one sections to another
 * (helpful in finding OEP of packed file)
 * args:
-* -m    <module_name> ; Analysed module name (by default same as app name)
+* -m    <module_name> ; Analysed module name (by default same as app name), or a list of the names
 * -o    <output_path> Output file
 *
 */
 
 #include <iostream>
+#include <iomanip>
+#include <set>
 #include <string>
 
 #include "pin.H"
@@ -18,6 +20,17 @@
 #include "ProcessInfo.h"
 #include "TraceLog.h"
 #include "FuncWatch.h"
+#include "ThreadData.h"
+#include "SyscallsTable.h"
+#include "BasicBlocks.h"
+#include "MemWatch.h"
+#include "Taint.h"
+#include "SampleProfile.h"
+#include "ProcessIndex.h"
+#include "ParamStr.h"
+#include "ReplayRecord.h"
+#include "SelfProfile.h"
+#include "LiveStatus.h"
 
 #define TOOL_NAME "TinyTracer"
 #define VERSION "1.5.1"
@@ -40,18 +53,94 @@ ProcessInfo pInfo;
 TraceLog traceLog;
 
 bool m_TraceRDTSC = false;
+bool m_TraceSyscalls = false;
+bool m_ShadowStack = false;
+bool m_Latency = false;
+bool m_CallGraph = false;
+bool m_Coverage = false;
+size_t m_HotBlocks = 0;
+bool m_BranchTrace = false;
+bool m_MemWatch = false;
+bool m_Taint = false;
+size_t m_SamplePeriod = 0;
+bool m_ModuleMatrix = false;
+bool m_Record = false;
 t_shellc_options m_FollowShellcode = SHELLC_DO_NOT_FOLLOW;
 
 FuncWatchList g_Watch;
 
+TLS_KEY tls_key = INVALID_TLS_KEY;
+
+// durations of the watched functions, merged from all the threads
+LatencyStats* g_Latency = NULL;
+
+// the graph of the calls, merged from all the threads
+CallGraph g_CallGraph;
+
+// the basic blocks of the watched code
+BlocksRegistry g_Blocks;
+
+// n-grams of the API calls, merged from all the threads
+ApiFingerprint* g_Fingerprint = NULL;
+
+// the events saved as a timeline
+TimelineLog* g_Timeline = NULL;
+
+// the branch decisions of the watched code
+BranchTrace g_BranchTrace;
+
+// the memory ranges, accesses to which are logged
+MemRanges g_MemRanges;
+
+// keeps the recent events in memory, instead of writing them all
+FlightRecorder* g_Recorder = NULL;
+
+// the events seen in the reference run
+EventBaseline* g_Baseline = NULL;
+
+// labels of the memory tainted by the outputs of the watched functions
+ShadowMemory g_Shadow;
+
+// the tainted branches that were already logged
+std::set<ADDRINT> g_TaintedBranches;
+
+// the profile built from the sampled addresses
+SampleProfile g_Profile;
+
+// ids of all the loaded modules
+ModuleIds g_ModuleIds;
+
+// the transitions between the modules, merged from all the threads
+TransitionMatrix* g_Transitions = NULL;
+
+// the processes traced along with the current one
+ProcessIndex g_ProcIndex;
+
+// the command line of Pin (without the application), to be passed to the child processes
+std::vector<std::string> g_PinArgs;
+
+// the inputs of the analysis routines, recorded for the offline replay
+ReplayWriter g_Replay;
+
+// the counters of the tool's own work
+SelfProfile* g_SelfProfile = NULL;
+
+// the progress of the trace, exposed to the other processes
+LiveStatus g_LiveStatus;
+
+// the tool register keeping the ThreadData of the current thread, so that the sampling check can be inlined
+REG g_ThreadDataReg = REG_INVALID();
+
 /* ===================================================================== */
 // Command line switches
 /* ===================================================================== */
 KNOB<std::string> KnobOutputFile(KNOB_MODE_WRITEONCE, "pintool",
     "o", "", "Specify file name for the output");
 
-KNOB<std::string> KnobModuleName(KNOB_MODE_WRITEONCE, "pintool",
-    "m", "", "Analysed module name (by default same as app name)");
+KNOB<std::string> KnobModuleName(KNOB_MODE_APPEND, "pintool",
+    "m", "", "Analysed module name (by default same as app name).\n"
+    "Multiple modules can be given as a list separated by ',' (or by passing the switch multiple times).\n"
+    "The names containing wildcards ('*', '?') are matched against the file name, i.e. payload*.dll");
 
 KNOB<std::string> KnobWatchListFile(KNOB_MODE_WRITEONCE, "pintool",
     "b", "", "A list of watched functions (dump parameters before the execution)");
@@ -62,6 +151,88 @@ KNOB<bool> KnobShortLog(KNOB_MODE_WRITEONCE, "pintool",
 KNOB<bool> KnobTraceRDTSC(KNOB_MODE_WRITEONCE, "pintool",
     "d", "", "Trace RDTSC");
 
+KNOB<bool> KnobTraceSyscalls(KNOB_MODE_WRITEONCE, "pintool",
+    "sys", "", "Trace syscalls issued directly from the traced module (and the followed shellcodes)");
+
+KNOB<bool> KnobShadowStack(KNOB_MODE_WRITEONCE, "pintool",
+    "cs", "", "Track the calls of the watched code: tag the logged calls with the call depth, print backtraces of the watched functions");
+
+KNOB<bool> KnobLatency(KNOB_MODE_WRITEONCE, "pintool",
+    "lat", "", "Measure the durations of the watched functions called from the traced code, and write their histograms at exit");
+
+KNOB<bool> KnobCallGraph(KNOB_MODE_WRITEONCE, "pintool",
+    "graph", "", "Instead of logging each call, aggregate the calls into a graph, and write it at exit (as DOT and JSON)");
+
+KNOB<bool> KnobCoverage(KNOB_MODE_WRITEONCE, "pintool",
+    "cov", "", "Save the coverage of the basic blocks of the traced module (and the followed shellcodes) in the drcov format");
+
+KNOB<int> KnobHotBlocks(KNOB_MODE_WRITEONCE, "pintool",
+    "hot", "0", "Count the executions of the basic blocks of the traced module (and the followed shellcodes).\n"
+    "At exit, save the given number of the most frequently executed blocks, and the totals per section (0 - disabled)");
+
+KNOB<int> KnobNgrams(KNOB_MODE_WRITEONCE, "pintool",
+    "ngram", "0", "Count the n-grams of the API calls of the given length, and save the most frequent ones as a fingerprint (0 - disabled)");
+
+KNOB<bool> KnobTimeline(KNOB_MODE_WRITEONCE, "pintool",
+    "timeline", "", "Save also the timeline of the events in the Chrome Trace Event format (for chrome://tracing or Perfetto)");
+
+KNOB<bool> KnobBranchTrace(KNOB_MODE_WRITEONCE, "pintool",
+    "bt", "", "Save the outcomes of the conditional branches, and the targets of the indirect branches, executed by the watched code.\n"
+    "The path can be reconstructed offline, from the module image");
+
+KNOB<std::string> KnobMemRanges(KNOB_MODE_APPEND, "pintool",
+    "mem", "", "Log the reads and writes done by the traced module within the given memory range (can be passed multiple times).\n"
+    "\t<start>-<end> - RVAs within the (main) traced module, i.e. 2a000-2a400\n"
+    "\t@<start>-<end> - absolute addresses\n"
+    "The accesses relative to the stack pointer are not logged");
+
+KNOB<int> KnobFlightRecorder(KNOB_MODE_WRITEONCE, "pintool",
+    "flight", "0", "Flight recorder: keep only the given number of the most recent events per thread in memory,\n"
+    "and write them only on an exception, on a call to the trigger function, or at exit (0 - disabled: write all the events)");
+
+KNOB<std::string> KnobFlightTrigger(KNOB_MODE_APPEND, "pintool",
+    "flight_on", "", "Name of the function, a call to which triggers writing the events kept by the flight recorder (can be passed multiple times)");
+
+KNOB<std::string> KnobBaseline(KNOB_MODE_WRITEONCE, "pintool",
+    "baseline", "", "Baseline file: do not log the events that were already seen in the reference run");
+
+KNOB<std::string> KnobBaselineOut(KNOB_MODE_WRITEONCE, "pintool",
+    "baseline_out", "", "Save the hashes of all the events of this run as a baseline file (i.e. from a clean run)");
+
+KNOB<bool> KnobBaselineRva(KNOB_MODE_WRITEONCE, "pintool",
+    "baseline_rva", "", "When creating the baseline: match the events also by the section and the RVA of the caller (only the same call sites are skipped)");
+
+KNOB<bool> KnobTaint(KNOB_MODE_WRITEONCE, "pintool",
+    "taint", "", "Taint the outputs of the watched functions (marked for capture in the watch list),\n"
+    "and log the conditional branches of the traced module that depend on them");
+
+KNOB<int> KnobSample(KNOB_MODE_WRITEONCE, "pintool",
+    "sample", "0", "Sampling profiler: take the address executed by each thread every given number of instructions,\n"
+    "and save at exit the flat profile per section of the traced module, shellcode, or API (0 - disabled)");
+
+KNOB<bool> KnobModuleMatrix(KNOB_MODE_WRITEONCE, "pintool",
+    "matrix", "", "Count the indirect transitions between all the modules of the process (not only the traced one),\n"
+    "and save them at exit as a matrix");
+
+KNOB<bool> KnobFollowChild(KNOB_MODE_WRITEONCE, "pintool",
+    "follow_child", "", "Trace also the child processes (with the same options), each into its own output: <output>.<pid>.<ext>.\n"
+    "The tree of the processes is saved in: <output>.procs");
+
+KNOB<std::string> KnobRecord(KNOB_MODE_WRITEONCE, "pintool",
+    "record", "", "Record the inputs of the analysis routines (the loaded images, the transitions, the RDTSC/CPUID sites, the arguments of the watched functions)\n"
+    "into the given file, so that they can be replayed without Pin (see: bench/replay)");
+
+KNOB<bool> KnobSelfProfile(KNOB_MODE_WRITEONCE, "pintool",
+    "stats", "", "Count the calls of the analysis routines, the time spent in them, in writing, and in waiting for the lock,\n"
+    "and save them at exit, along with the statistics of the code cache, as: <output>.stats");
+
+KNOB<bool> KnobLiveStatus(KNOB_MODE_WRITEONCE, "pintool",
+    "live", "", "Expose the progress of the trace (the counts of the events, the bytes written, the fill of the buffers, the current section of each thread)\n"
+    "in a small file mapped into the memory: <output>.live, to be watched with: install_linux/live_status.py");
+
+KNOB<int> KnobParentPid(KNOB_MODE_WRITEONCE, "pintool",
+    "parent_pid", "0", "PID of the traced parent (set automatically for the followed child processes)");
+
 KNOB<int> KnobFollowShellcode(KNOB_MODE_WRITEONCE, "pintool",
     "f", "", "Trace calls executed from shellcodes loaded in the memory:\n"
     "\t0 - trace only the main target module\n"
@@ -107,6 +278,113 @@ bool isStrEqualI(const std::string &str1, const std::string &str2)
     return true;
 }
 
+// take the client lock, counting the time of waiting for it (if profiled)
+VOID LockClient()
+{
+    if (!g_SelfProfile) {
+        PIN_LockClient();
+        return;
+    }
+    const UINT64 start = util::getTimestamp();
+    PIN_LockClient();
+    g_SelfProfile->addLockWait(PIN_ThreadId(), util::getTimestamp() - start);
+}
+
+ThreadData* getThreadData(const THREADID tid)
+{
+    return static_cast<ThreadData*>(PIN_GetThreadData(tls_key, tid));
+}
+
+int getCallDepth()
+{
+    if (!m_ShadowStack) {
+        return DEPTH_UNKNOWN;
+    }
+    const ThreadData* data = getThreadData(PIN_ThreadId());
+    if (!data) {
+        return DEPTH_UNKNOWN;
+    }
+    return (int)data->stack.depth();
+}
+
+/* ===================================================================== */
+// Call graph nodes
+/* ===================================================================== */
+
+ADDRINT getSectionNode(const ADDRINT Address)
+{
+    const ADDRINT base = get_mod_base(Address);
+    const s_module* sec = pInfo.getSecByAddr(Address);
+    const ADDRINT key = (sec) ? (base + sec->start) : base;
+    if (!g_CallGraph.hasNode(key)) {
+        IMG img = IMG_FindByAddress(Address);
+        std::string name = (IMG_Valid(img)) ? util::getDllName(IMG_Name(img)) : "?";
+        if (sec) {
+            name += ":" + sec->name;
+        }
+        g_CallGraph.addNode(key, name, NODE_SECTION);
+    }
+    return key;
+}
+
+ADDRINT getApiNode(const ADDRINT Address, IMG Image)
+{
+    if (!g_CallGraph.hasNode(Address)) {
+        const std::string name = util::getDllName(IMG_Name(Image)) + "." + get_func_at(Address);
+        g_CallGraph.addNode(Address, name, NODE_API);
+    }
+    return Address;
+}
+
+ADDRINT getShellcodeNode(const ADDRINT pageBase)
+{
+    if (!g_CallGraph.hasNode(pageBase)) {
+        std::stringstream ss;
+        ss << "shellcode_" << std::hex << pageBase;
+        g_CallGraph.addNode(pageBase, ss.str(), NODE_SHELLCODE);
+    }
+    return pageBase;
+}
+
+VOID addCallEdge(const ADDRINT fromNode, const ADDRINT toNode)
+{
+    ThreadData* data = getThreadData(PIN_ThreadId());
+    if (!data || !data->edges) return;
+    data->edges->add(fromNode, toNode);
+}
+
+VOID addApiToFingerprint(const ADDRINT Address, IMG Image)
+{
+    ThreadData* data = getThreadData(PIN_ThreadId());
+    if (!data || !data->ngrams) return;
+
+    UINT64 apiHash = 0;
+    if (g_Fingerprint->hasApi(Address)) {
+        apiHash = g_Fingerprint->getApiHash(Address);
+    }
+    else {
+        const std::string name = util::getDllName(IMG_Name(Image)) + "." + get_func_at(Address);
+        apiHash = g_Fingerprint->addApi(Address, name);
+    }
+    data->ngrams->addApi(apiHash);
+}
+
+// the caller of the event, as matched against the baseline: the traced module (optionally, with the section), or the shellcode
+std::string getCallerName(const ADDRINT base, const ADDRINT rva, const bool withSection)
+{
+    const s_traced_module* mod = (base) ? pInfo.getTracedModule(base) : pInfo.getMainModule();
+    if (!mod) {
+        return "[shellcode]";
+    }
+    // the main module is the sample itself: its name differs between the samples
+    const std::string name = (mod == pInfo.getMainModule()) ? "[main]" : util::getDllName(mod->name);
+    if (!withSection) {
+        return name;
+    }
+    const s_module* sec = pInfo.getSecByAddr(mod->base + rva);
+    return name + ":" + ((sec) ? sec->name : "?");
+}
+
 /* ===================================================================== */
 // Analysis routines
 /* ===================================================================== */
@@ -117,8 +395,14 @@ VOID _SaveTransitions(const ADDRINT addrFrom, const ADDRINT addrTo)
     // last shellcode to which the transition got redirected:
     static ADDRINT lastShellc = UNKNOWN_ADDR;
 
+    if (m_Record) {
+        g_Replay.recordTransition(PIN_ThreadId(), addrFrom, addrTo);
+    }
+
     const bool isTargetMy = pInfo.isMyAddress(addrTo);
     const bool isCallerMy = pInfo.isMyAddress(addrFrom);
+    // the transitions between different traced modules are logged as the calls
+    const bool isSameModule = isCallerMy && isTargetMy && (pInfo.getTracedModule(addrFrom) == pInfo.getTracedModule(addrTo));
 
     IMG targetModule = IMG_FindByAddress(addrTo);
     IMG callerModule = IMG_FindByAddress(addrFrom);
@@ -127,17 +411,36 @@ VOID _SaveTransitions(const ADDRINT addrFrom, const ADDRINT addrTo)
     ADDRINT pageTo = GetPageOfAddr(addrTo);
 
     //is it a transition from the traced module to a foreign module?
-    if (isCallerMy && !isTargetMy) {
+    if (isCallerMy && !isSameModule) {
         ADDRINT RvaFrom = addr_to_rva(addrFrom);
+        const ADDRINT baseFrom = pInfo.getLogBase(addrFrom);
         if (IMG_Valid(targetModule)) {
-            const std::string func = get_func_at(addrTo);
-            const std::string dll_name = IMG_Name(targetModule);
-            traceLog.logCall(0, RvaFrom, true, dll_name, func);
+            if (g_Fingerprint) {
+                addApiToFingerprint(addrTo, targetModule);
+            }
+            if (m_CallGraph) {
+                addCallEdge(getSectionNode(addrFrom), getApiNode(addrTo, targetModule));
+            }
+            else {
+                const std::string func = get_func_at(addrTo);
+                const std::string dll_name = IMG_Name(targetModule);
+                if (baseFrom) {
+                    traceLog.logCall(baseFrom, addrFrom, false, dll_name, func, getCallDepth());
+                }
+                else {
+                    traceLog.logCall(0, RvaFrom, true, dll_name, func, getCallDepth());
+                }
+            }
         }
         else {
             //not in any of the mapped modules:
             lastShellc = pageTo; //save the beginning of this area
-            traceLog.logCall(0, RvaFrom, lastShellc, addrTo);
+            if (m_CallGraph) {
+                addCallEdge(getSectionNode(addrFrom), getShellcodeNode(lastShellc));
+            }
+            else {
+                traceLog.logCall(baseFrom, RvaFrom, lastShellc, addrTo, getCallDepth());
+            }
         }
     }
     // trace calls from witin the last shellcode that was called from the traced module:
@@ -147,13 +450,24 @@ VOID _SaveTransitions(const ADDRINT addrFrom, const ADDRINT addrTo)
         if (callerPage != UNKNOWN_ADDR && callerPage == lastShellc) {
 
             if (IMG_Valid(targetModule)) {
-                const std::string func = get_func_at(addrTo);
-                const std::string dll_name = IMG_Name(targetModule);
-                traceLog.logCall(callerPage, addrFrom, false, dll_name, func);
+                if (g_Fingerprint) {
+                    addApiToFingerprint(addrTo, targetModule);
+                }
+                if (m_CallGraph) {
+                    addCallEdge(getShellcodeNode(callerPage), getApiNode(addrTo, targetModule));
+                }
+                else {
+                    const std::string func = get_func_at(addrTo);
+                    const std::string dll_name = IMG_Name(targetModule);
+                    traceLog.logCall(callerPage, addrFrom, false, dll_name, func, getCallDepth());
+                }
             }
             else if (pageFrom != pageTo
                 && m_FollowShellcode == SHELLC_FOLLOW_RECURSIVE)
             {
+                if (m_CallGraph) {
+                    addCallEdge(getShellcodeNode(callerPage), getShellcodeNode(pageTo));
+                }
                 // set the called shellcode as the current:
                 lastShellc = pageTo;
             }
@@ -165,38 +479,42 @@ VOID _SaveTransitions(const ADDRINT addrFrom, const ADDRINT addrTo)
         ADDRINT rva = addr_to_rva(addrTo); // convert to RVA
 
         // is it a transition from one section to another?
-        if (pInfo.updateTracedModuleSection(rva)) {
-            const s_module* sec = pInfo.getSecByAddr(rva);
-            std::string curr_name = (sec) ? sec->name : "?";
+        if (pInfo.updateTracedModuleSection(addrTo)) {
+            std::string curr_name = pInfo.getSecName(addrTo);
             if (isCallerMy) {
 
                 ADDRINT rvaFrom = addr_to_rva(addrFrom); // convert to RVA
-                const s_module* prev_sec = pInfo.getSecByAddr(rvaFrom);
-                std::string prev_name = (prev_sec) ? prev_sec->name : "?";
-                traceLog.logNewSectionCalled(rvaFrom, prev_name, curr_name);
+                std::string prev_name = pInfo.getSecName(addrFrom);
+                traceLog.logNewSectionCalled(pInfo.getLogBase(addrFrom), rvaFrom, prev_name, curr_name);
             }
-            traceLog.logSectionChange(rva, curr_name);
+            traceLog.logSectionChange(pInfo.getLogBase(addrTo), rva, curr_name);
+            g_LiveStatus.setSection(PIN_ThreadId(), curr_name);
         }
     }
 }
 
 VOID SaveTransitions(const ADDRINT prevVA, const ADDRINT Address)
 {
-    PIN_LockClient();
+    ProfileScope scope(g_SelfProfile, PROF_TRANSITION);
+    LockClient();
     _SaveTransitions(prevVA, Address);
     PIN_UnlockClient();
 }
 
 VOID RdtscCalled(const CONTEXT* ctxt)
 {
-    PIN_LockClient();
+    ProfileScope scope(g_SelfProfile, PROF_RDTSC);
+    LockClient();
 
     ADDRINT Address = (ADDRINT)PIN_GetContextReg(ctxt, REG_INST_PTR);
+    if (m_Record) {
+        g_Replay.recordRdtsc(PIN_ThreadId(), Address);
+    }
     IMG currModule = IMG_FindByAddress(Address);
     const bool isCurrMy = pInfo.isMyAddress(Address);
     if (isCurrMy) {
         ADDRINT rva = addr_to_rva(Address); // convert to RVA
-        traceLog.logRdtsc(0, rva);
+        traceLog.logRdtsc(pInfo.getLogBase(Address), rva);
     }
     if (m_FollowShellcode && !IMG_Valid(currModule)) {
         const ADDRINT start = GetPageOfAddr(Address);
@@ -211,16 +529,20 @@ VOID RdtscCalled(const CONTEXT* ctxt)
 
 VOID CpuidCalled(const CONTEXT* ctxt)
 {
-    PIN_LockClient();
+    ProfileScope scope(g_SelfProfile, PROF_CPUID);
+    LockClient();
 
     ADDRINT Address = (ADDRINT)PIN_GetContextReg(ctxt, REG_INST_PTR);
     ADDRINT Param = (ADDRINT)PIN_GetContextReg(ctxt, REG_GAX);
+    if (m_Record) {
+        g_Replay.recordCpuid(PIN_ThreadId(), Address, Param);
+    }
 
     IMG currModule = IMG_FindByAddress(Address);
     const bool isCurrMy = pInfo.isMyAddress(Address);
     if (isCurrMy) {
         ADDRINT rva = addr_to_rva(Address); // convert to RVA
-        traceLog.logCpuid(0, rva, Param);
+        traceLog.logCpuid(pInfo.getLogBase(Address), rva, Param);
     }
     if (m_FollowShellcode && !IMG_Valid(currModule)) {
         const ADDRINT start = GetPageOfAddr(Address);
@@ -258,9 +580,10 @@ ADDRINT _setTimer(const CONTEXT* ctxt, bool isEax)
 
 ADDRINT AlterRdtscValueEdx(const CONTEXT* ctxt)
 {
+    ProfileScope scope(g_SelfProfile, PROF_RDTSC_ALTER);
     ADDRINT result = 0;
 
-    PIN_LockClient();
+    LockClient();
     result = _setTimer(ctxt, false);
     PIN_UnlockClient();
 
@@ -269,9 +592,10 @@ ADDRINT AlterRdtscValueEdx(const CONTEXT* ctxt)
 
 ADDRINT AlterRdtscValueEax(const CONTEXT* ctxt)
 {
+    ProfileScope scope(g_SelfProfile, PROF_RDTSC_ALTER);
     ADDRINT result = 0;
 
-    PIN_LockClient();
+    LockClient();
     result = _setTimer(ctxt, true);
     PIN_UnlockClient();
 
@@ -279,185 +603,1341 @@ ADDRINT AlterRdtscValueEax(const CONTEXT* ctxt)
 }
 
 /* ===================================================================== */
-// Instrument functions arguments
+// Shadow stack of the watched code
 /* ===================================================================== */
 
-bool isWatchedAddress(const ADDRINT Address)
+VOID PIN_FAST_ANALYSIS_CALL ShadowStackCall(const THREADID tid, const ADDRINT retAddr, const ADDRINT stackPtr)
 {
-    IMG currModule = IMG_FindByAddress(Address);
-    const bool isCurrMy = pInfo.isMyAddress(Address);
-    if (isCurrMy) {
-        return true;
-    }
-    if (m_FollowShellcode && !IMG_Valid(currModule)) {
-        const ADDRINT start = GetPageOfAddr(Address);
-        ADDRINT rva = Address - start;
-        if (start != UNKNOWN_ADDR) {
-            return true;
-        }
-    }
-    return false;
+    ThreadData* data = getThreadData(tid);
+    if (!data) return;
+    data->stack.push(retAddr, stackPtr);
 }
 
-std::wstring paramToStr(VOID *arg1)
+VOID PIN_FAST_ANALYSIS_CALL ShadowStackRet(const THREADID tid, const ADDRINT stackPtr)
 {
-    if (arg1 == NULL) {
-        return L"0";
-    }
-    const size_t kMaxStr = 300;
-    const BOOL isReadableAddr = PIN_CheckReadAccess(arg1);
-    std::wstringstream ss;
+    ThreadData* data = getThreadData(tid);
+    if (!data) return;
+    data->stack.pop(stackPtr);
+}
 
-    if (!isReadableAddr) {
-        // single value
-        ss << std::hex << (arg1);
-        return ss.str();
-    }
-    bool isSet = false;
-    const char* val = (char*)arg1;
-    size_t len = util::getAsciiLen(val, kMaxStr);
+VOID PIN_FAST_ANALYSIS_CALL ShadowStackUnwind(const THREADID tid, const ADDRINT stackPtr)
+{
+    ThreadData* data = getThreadData(tid);
+    if (!data) return;
+    data->stack.unwind(stackPtr);
+}
 
-    if (len == 1) { // Possible wideString
-        wchar_t* val = (wchar_t*)arg1;
-        size_t wLen = util::getAsciiLenW(val, kMaxStr);
-        if (wLen >= len) {
-            ss << "L\"" << val << "\"";
-            isSet = true;
-        }
-    }
-    else if (len > 1) { // ASCII string
-        ss << "\"" << val << "\"";
-        isSet = true;
-    }
+/* ===================================================================== */
+// Branch trace of the watched code
+/* ===================================================================== */
 
-    if (!isSet) { // none of the above, possible pointer to some structure
-        ss << "ptr " << std::hex << (arg1);
-    }
-    return ss.str();
+VOID PIN_FAST_ANALYSIS_CALL BranchCond(const THREADID tid, const ADDRINT Address, const BOOL isTaken)
+{
+    ThreadData* data = getThreadData(tid);
+    if (!data || !data->branches) return;
+    data->branches->addCond(Address, isTaken ? true : false);
 }
 
-VOID _LogFunctionArgs(const ADDRINT Address, CHAR *name, uint32_t argCount, VOID *arg1, VOID *arg2, VOID *arg3, VOID *arg4, VOID *arg5, VOID *arg6, VOID *arg7, VOID *arg8, VOID *arg9, VOID *arg10)
+VOID PIN_FAST_ANALYSIS_CALL BranchIndirect(const THREADID tid, const ADDRINT Address, const ADDRINT target)
 {
-    if (!isWatchedAddress(Address)) return;
+    ThreadData* data = getThreadData(tid);
+    if (!data || !data->branches) return;
+    // a target out of the traced modules (i.e. in a shellcode) forces a resync at the next branch
+    data->branches->addTarget(Address, target, pInfo.isMyAddress(target));
+}
 
-    const size_t argsMax = 10;
-    VOID* args[argsMax] = { arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9, arg10 };
-    std::wstringstream ss;
-    for (size_t i = 0; i < argCount && i < argsMax; i++) {
-        ss << "\tArg[" << i << "] = ";
-        ss << paramToStr(args[i]);
-        ss << "\n";
+VOID PIN_FAST_ANALYSIS_CALL BranchLeave(const THREADID tid)
+{
+    ThreadData* data = getThreadData(tid);
+    if (!data || !data->branches) return;
+    data->branches->leave();
+}
+
+// remember the module, that will be needed to decode the branches within it
+VOID addBranchModule(const ADDRINT Address)
+{
+    IMG Image = IMG_FindByAddress(Address);
+    if (IMG_Valid(Image)) {
+        g_BranchTrace.addModule(IMG_LoadOffset(Image), IMG_HighAddress(Image), IMG_Name(Image));
+        return;
+    }
+    const ADDRINT start = GetPageOfAddr(Address);
+    if (start != UNKNOWN_ADDR) {
+        g_BranchTrace.addModule(start, start + PAGE_SIZE - 1, "shellcode");
     }
+}
 
-    std::wstring argsLineW = ss.str();
-    std::string s(argsLineW.begin(), argsLineW.end());
-    traceLog.logLine(s);
+/* ===================================================================== */
+// Trace the accesses to the watched memory
+/* ===================================================================== */
+
+// the caller must hold the client lock
+VOID _FlushMemAccess(ThreadData* data)
+{
+    if (!data || !data->memAccess || !data->memAccess->count()) return;
+
+    for (size_t i = 0; i < data->memAccess->count(); i++) {
+        const s_mem_access &access = data->memAccess->at(i);
+        traceLog.logMemAccess(pInfo.getLogBase(access.insAddr), addr_to_rva(access.insAddr), access.isWrite, access.addr, access.size, access.count);
+    }
+    data->memAccess->clear();
 }
 
-VOID LogFunctionArgs(const ADDRINT Address, CHAR *name, uint32_t argCount, VOID *arg1, VOID *arg2, VOID *arg3, VOID *arg4, VOID *arg5, VOID *arg6, VOID *arg7, VOID *arg8, VOID *arg9, VOID *arg10)
+VOID FlushMemAccess(ThreadData* data)
 {
-    PIN_LockClient();
-    _LogFunctionArgs(Address, name, argCount, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9, arg10);
+    if (!data || !data->memAccess || !data->memAccess->count()) return;
+
+    ProfileScope scope(g_SelfProfile, PROF_MEM_ACCESS);
+    LockClient();
+    _FlushMemAccess(data);
     PIN_UnlockClient();
 }
 
-VOID MonitorFunctionArgs(IMG Image, const WFuncInfo &funcInfo)
+// called by the TraceLog before any other event of the thread is written, so that the accesses stay in order with the other events
+VOID FlushMemAccessBeforeEvent(const THREADID tid)
 {
-    const CHAR* fName = funcInfo.funcName.c_str();
-    size_t argNum = funcInfo.paramCount;
-    RTN funcRtn = RTN_FindByName(Image, fName);
-    if (!RTN_Valid(funcRtn) || !funcInfo.isValid()) return; // failed
+    _FlushMemAccess(getThreadData(tid));
+}
 
-    std::cout << "Watch " << IMG_Name(Image) << ": " << fName << " [" << argNum << "]\n";
-    RTN_Open(funcRtn);
+ADDRINT PIN_FAST_ANALYSIS_CALL IsMemInBox(const ADDRINT addr, const UINT32 size)
+{
+    return g_MemRanges.isInBox(addr, size);
+}
 
-    RTN_InsertCall(funcRtn, IPOINT_BEFORE, AFUNPTR(LogFunctionArgs),
-        IARG_RETURN_IP,
-        IARG_ADDRINT, fName,
-        IARG_UINT32, argNum,
-        IARG_FUNCARG_ENTRYPOINT_VALUE, 0,
-        IARG_FUNCARG_ENTRYPOINT_VALUE, 1,
-        IARG_FUNCARG_ENTRYPOINT_VALUE, 2,
-        IARG_FUNCARG_ENTRYPOINT_VALUE, 3,
-        IARG_FUNCARG_ENTRYPOINT_VALUE, 4,
-        IARG_FUNCARG_ENTRYPOINT_VALUE, 5,
-        IARG_FUNCARG_ENTRYPOINT_VALUE, 6,
-        IARG_FUNCARG_ENTRYPOINT_VALUE, 7,
-        IARG_FUNCARG_ENTRYPOINT_VALUE, 8,
-        IARG_FUNCARG_ENTRYPOINT_VALUE, 9,
-        IARG_FUNCARG_ENTRYPOINT_VALUE, 10,
-        IARG_END
-    );
+VOID RecordMemAccess(const THREADID tid, const ADDRINT insAddr, const ADDRINT addr, const UINT32 size, const BOOL isWrite)
+{
+    if (!g_MemRanges.overlaps(addr, size)) return;
 
-    RTN_Close(funcRtn);
+    ThreadData* data = getThreadData(tid);
+    if (!data || !data->memAccess) return;
+    if (!data->memAccess->add(insAddr, addr, size, isWrite ? true : false)) {
+        FlushMemAccess(data);
+        data->memAccess->add(insAddr, addr, size, isWrite ? true : false);
+    }
 }
 
+typedef enum {
+    MEMOP_SKIP = 0,  // statically known to be out of the ranges
+    MEMOP_CHECK,     // the address must be checked at runtime
+    MEMOP_ALWAYS     // statically known to be within the ranges
+} t_memop_check;
 
-/* ===================================================================== */
-// Instrumentation callbacks
-/* ===================================================================== */
-
-VOID InstrumentInstruction(INS ins, VOID *v)
+t_memop_check checkMemOperand(INS ins, const UINT32 memOp)
 {
-    if (isStrEqualI(INS_Mnemonic(ins), "cpuid")) {
-        INS_InsertCall(
-            ins,
-            IPOINT_BEFORE, (AFUNPTR)CpuidCalled,
-            IARG_CONTEXT,
-            IARG_END
-        );
+    // the instructions with multiple memory operands (i.e. movs) are always checked
+    if (INS_MemoryOperandCount(ins) != 1) {
+        return MEMOP_CHECK;
+    }
+    if (INS_IsStackRead(ins) || INS_IsStackWrite(ins)) {
+        return MEMOP_SKIP;
+    }
+    const REG baseReg = INS_MemoryBaseReg(ins);
+    const REG indexReg = INS_MemoryIndexReg(ins);
+    if (baseReg == REG_STACK_PTR) {
+        return MEMOP_SKIP;
+    }
+    if (REG_valid(indexReg) || REG_valid(INS_SegmentRegPrefix(ins))) {
+        return MEMOP_CHECK;
+    }
+    ADDRINT addr = 0;
+    if (!REG_valid(baseReg)) {
+        addr = (ADDRINT)INS_MemoryDisplacement(ins);
+    }
+    else if (baseReg == REG_INST_PTR) {
+        addr = INS_NextAddress(ins) + INS_MemoryDisplacement(ins);
     }
+    else {
+        return MEMOP_CHECK;
+    }
+    // the address is constant
+    const UINT32 size = (UINT32)INS_MemoryOperandSize(ins, memOp);
+    return g_MemRanges.overlaps(addr, size) ? MEMOP_ALWAYS : MEMOP_SKIP;
+}
 
-    if (INS_IsRDTSC(ins)) {
-        if (m_TraceRDTSC) {
-            INS_InsertCall(
+VOID InstrumentMemAccess(INS ins)
+{
+    const UINT32 memOperands = INS_MemoryOperandCount(ins);
+    for (UINT32 memOp = 0; memOp < memOperands; memOp++) {
+        const t_memop_check check = checkMemOperand(ins, memOp);
+        if (check == MEMOP_SKIP) continue;
+
+        const UINT32 size = (UINT32)INS_MemoryOperandSize(ins, memOp);
+        const BOOL isWrite = INS_MemoryOperandIsWritten(ins, memOp);
+        if (check == MEMOP_CHECK) {
+            INS_InsertIfPredicatedCall(
                 ins,
-                IPOINT_BEFORE, (AFUNPTR)RdtscCalled,
-                IARG_CONTEXT,
+                IPOINT_BEFORE, (AFUNPTR)IsMemInBox,
+                IARG_FAST_ANALYSIS_CALL,
+                IARG_MEMORYOP_EA, memOp,
+                IARG_UINT32, size,
+                IARG_END
+            );
+            INS_InsertThenPredicatedCall(
+                ins,
+                IPOINT_BEFORE, (AFUNPTR)RecordMemAccess,
+                IARG_THREAD_ID,
+                IARG_INST_PTR,
+                IARG_MEMORYOP_EA, memOp,
+                IARG_UINT32, size,
+                IARG_BOOL, isWrite,
+                IARG_END
+            );
+        }
+        else {
+            INS_InsertPredicatedCall(
+                ins,
+                IPOINT_BEFORE, (AFUNPTR)RecordMemAccess,
+                IARG_THREAD_ID,
+                IARG_INST_PTR,
+                IARG_MEMORYOP_EA, memOp,
+                IARG_UINT32, size,
+                IARG_BOOL, isWrite,
                 IARG_END
             );
         }
+    }
+}
 
-        INS_InsertCall(
-            ins, 
-            IPOINT_AFTER, (AFUNPTR)AlterRdtscValueEdx,
-            IARG_CONTEXT,
-            IARG_RETURN_REGS, 
-            REG_GDX,
-            IARG_END);
+/* ===================================================================== */
+// Taint propagation within the traced module
+/* ===================================================================== */
 
-        INS_InsertCall(ins, 
-            IPOINT_AFTER, (AFUNPTR)AlterRdtscValueEax,
-            IARG_CONTEXT,
-            IARG_RETURN_REGS,
-            REG_GAX,
-            IARG_END);
-    }
+ADDRINT PIN_FAST_ANALYSIS_CALL IsTaintActive()
+{
+    return g_Shadow.isActive();
+}
 
-    if ((INS_IsControlFlow(ins) || INS_IsFarJump(ins))) {
-        INS_InsertCall(
-            ins, 
-            IPOINT_BEFORE, (AFUNPTR)SaveTransitions,
-            IARG_INST_PTR,
-            IARG_BRANCH_TARGET_ADDR,
-            IARG_END
-        );
+inline VOID _TaintPropagate(const THREADID tid, const UINT32 srcRegs, const UINT32 dstRegs,
+    const ADDRINT readAddr, const UINT32 readSize, const ADDRINT writeAddr, const UINT32 writeSize)
+{
+    ThreadData* data = getThreadData(tid);
+    if (!data || !data->taint) return;
+
+    UINT8 label = data->taint->getLabel(srcRegs);
+    if (label == TAINT_CLEAN && readSize) {
+        label = g_Shadow.get(readAddr, readSize);
+    }
+    if (writeSize) {
+        g_Shadow.set(writeAddr, writeSize, label);
+    }
+    data->taint->setLabel(dstRegs, label);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL TaintRegs(const THREADID tid, const UINT32 srcRegs, const UINT32 dstRegs)
+{
+    _TaintPropagate(tid, srcRegs, dstRegs, 0, 0, 0, 0);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL TaintLoad(const THREADID tid, const UINT32 srcRegs, const UINT32 dstRegs, const ADDRINT readAddr, const UINT32 readSize)
+{
+    _TaintPropagate(tid, srcRegs, dstRegs, readAddr, readSize, 0, 0);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL TaintStore(const THREADID tid, const UINT32 srcRegs, const UINT32 dstRegs, const ADDRINT writeAddr, const UINT32 writeSize)
+{
+    _TaintPropagate(tid, srcRegs, dstRegs, 0, 0, writeAddr, writeSize);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL TaintLoadStore(const THREADID tid, const UINT32 srcRegs, const UINT32 dstRegs,
+    const ADDRINT readAddr, const UINT32 readSize, const ADDRINT writeAddr, const UINT32 writeSize)
+{
+    _TaintPropagate(tid, srcRegs, dstRegs, readAddr, readSize, writeAddr, writeSize);
+}
+
+// the values of the volatile registers are overwritten by the called function (unless it is within the traced module)
+VOID PIN_FAST_ANALYSIS_CALL TaintCallOut(const THREADID tid, const ADDRINT target)
+{
+    if (pInfo.isMyAddress(target)) return;
+
+    ThreadData* data = getThreadData(tid);
+    if (!data || !data->taint) return;
+    data->taint->setLabel(taint::volatileRegsMask(), TAINT_CLEAN);
+}
+
+VOID TaintBranch(const THREADID tid, const ADDRINT Address)
+{
+    ProfileScope scope(g_SelfProfile, PROF_TAINTED_BRANCH);
+    ThreadData* data = getThreadData(tid);
+    if (!data || !data->taint) return;
+
+    const UINT8 label = data->taint->flags;
+    if (label == TAINT_CLEAN) return;
+
+    LockClient();
+    if (g_TaintedBranches.find(Address) == g_TaintedBranches.end()) {
+        g_TaintedBranches.insert(Address);
+        std::string source = "?";
+        if (label < TAINT_LABEL_MAX && size_t(label - 1) < g_Watch.funcs.size()) {
+            const WFuncInfo &info = g_Watch.funcs[label - 1];
+            source = info.getName();
+        }
+        traceLog.logTaintedBranch(pInfo.getLogBase(Address), addr_to_rva(Address), source);
+    }
+    PIN_UnlockClient();
+}
+
+// i.e. xor eax, eax: the result does not depend on the source
+bool isZeroingIdiom(INS ins)
+{
+    const std::string mnem = INS_Mnemonic(ins);
+    if (!isStrEqualI(mnem, "xor") && !isStrEqualI(mnem, "sub") && !isStrEqualI(mnem, "pxor")) {
+        return false;
+    }
+    return INS_OperandCount(ins) >= 2 && INS_OperandIsReg(ins, 0) && INS_OperandIsReg(ins, 1)
+        && INS_OperandReg(ins, 0) == INS_OperandReg(ins, 1);
+}
+
+VOID InstrumentTaint(INS ins)
+{
+    if (INS_IsCall(ins)) {
+        INS_InsertIfCall(ins, IPOINT_BEFORE, (AFUNPTR)IsTaintActive, IARG_FAST_ANALYSIS_CALL, IARG_END);
+        INS_InsertThenCall(
+            ins,
+            IPOINT_BEFORE, (AFUNPTR)TaintCallOut,
+            IARG_FAST_ANALYSIS_CALL,
+            IARG_THREAD_ID,
+            IARG_BRANCH_TARGET_ADDR,
+            IARG_END
+        );
+        return;
+    }
+    if (INS_IsBranch(ins) && INS_HasFallThrough(ins)) {
+        INS_InsertIfCall(ins, IPOINT_BEFORE, (AFUNPTR)IsTaintActive, IARG_FAST_ANALYSIS_CALL, IARG_END);
+        INS_InsertThenCall(
+            ins,
+            IPOINT_BEFORE, (AFUNPTR)TaintBranch,
+            IARG_THREAD_ID,
+            IARG_INST_PTR,
+            IARG_END
+        );
+        return;
+    }
+    if (INS_IsControlFlow(ins) || INS_IsNop(ins) || INS_IsPrefetch(ins)) {
+        return;
+    }
+
+    UINT32 srcRegs = 0;
+    UINT32 dstRegs = 0;
+    for (UINT32 i = 0; i < INS_MaxNumRRegs(ins); i++) {
+        srcRegs |= taint::regToMask(INS_RegR(ins, i));
+    }
+    for (UINT32 i = 0; i < INS_MaxNumWRegs(ins); i++) {
+        dstRegs |= taint::regToMask(INS_RegW(ins, i));
+    }
+    const bool isRead = INS_IsMemoryRead(ins) ? true : false;
+    const bool isWrite = INS_IsMemoryWrite(ins) ? true : false;
+    if (isRead || isWrite) {
+        // the registers used only to compute the address do not taint the value
+        const UINT32 addrRegs = taint::regToMask(INS_MemoryBaseReg(ins)) | taint::regToMask(INS_MemoryIndexReg(ins));
+        srcRegs &= ~(addrRegs & ~dstRegs);
+    }
+    if (isZeroingIdiom(ins)) {
+        srcRegs = 0;
+    }
+    if (!srcRegs && !dstRegs && !isRead && !isWrite) {
+        return; // nothing that could carry the taint
+    }
+
+    INS_InsertIfPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)IsTaintActive, IARG_FAST_ANALYSIS_CALL, IARG_END);
+    if (isRead && isWrite) {
+        INS_InsertThenPredicatedCall(
+            ins,
+            IPOINT_BEFORE, (AFUNPTR)TaintLoadStore,
+            IARG_FAST_ANALYSIS_CALL,
+            IARG_THREAD_ID,
+            IARG_UINT32, srcRegs,
+            IARG_UINT32, dstRegs,
+            IARG_MEMORYREAD_EA,
+            IARG_MEMORYREAD_SIZE,
+            IARG_MEMORYWRITE_EA,
+            IARG_MEMORYWRITE_SIZE,
+            IARG_END
+        );
+    }
+    else if (isRead) {
+        INS_InsertThenPredicatedCall(
+            ins,
+            IPOINT_BEFORE, (AFUNPTR)TaintLoad,
+            IARG_FAST_ANALYSIS_CALL,
+            IARG_THREAD_ID,
+            IARG_UINT32, srcRegs,
+            IARG_UINT32, dstRegs,
+            IARG_MEMORYREAD_EA,
+            IARG_MEMORYREAD_SIZE,
+            IARG_END
+        );
+    }
+    else if (isWrite) {
+        INS_InsertThenPredicatedCall(
+            ins,
+            IPOINT_BEFORE, (AFUNPTR)TaintStore,
+            IARG_FAST_ANALYSIS_CALL,
+            IARG_THREAD_ID,
+            IARG_UINT32, srcRegs,
+            IARG_UINT32, dstRegs,
+            IARG_MEMORYWRITE_EA,
+            IARG_MEMORYWRITE_SIZE,
+            IARG_END
+        );
+    }
+    else {
+        INS_InsertThenPredicatedCall(
+            ins,
+            IPOINT_BEFORE, (AFUNPTR)TaintRegs,
+            IARG_FAST_ANALYSIS_CALL,
+            IARG_THREAD_ID,
+            IARG_UINT32, srcRegs,
+            IARG_UINT32, dstRegs,
+            IARG_END
+        );
+    }
+}
+
+/* ===================================================================== */
+// Sampling profiler
+/* ===================================================================== */
+
+ADDRINT PIN_FAST_ANALYSIS_CALL SampleCountdown(ThreadData* data, const UINT32 insCount)
+{
+    data->sampleCountdown -= insCount;
+    return (data->sampleCountdown <= 0);
+}
+
+VOID TakeSample(ThreadData* data, const ADDRINT Address)
+{
+    ProfileScope scope(g_SelfProfile, PROF_SAMPLE);
+    data->sampleCountdown += m_SamplePeriod;
+
+    LockClient();
+    if (!g_Profile.addSample(Address)) {
+        // the address is sampled for the first time: attribute it
+        IMG img = IMG_FindByAddress(Address);
+        if (pInfo.isMyAddress(Address)) {
+            const s_module* sec = pInfo.getSecByAddr(Address);
+            g_Profile.addAddress(Address, util::getDllName(IMG_Name(img)) + ":" + ((sec) ? sec->name : "?"), SAMPLE_SECTION);
+        }
+        else if (IMG_Valid(img)) {
+            RTN rtn = RTN_FindByAddress(Address);
+            const std::string func = RTN_Valid(rtn) ? RTN_Name(rtn) : "?";
+            g_Profile.addAddress(Address, util::getDllName(IMG_Name(img)) + "." + func, SAMPLE_API);
+        }
+        else {
+            std::stringstream ss;
+            ss << "shellcode_" << std::hex << GetPageOfAddr(Address);
+            g_Profile.addAddress(Address, ss.str(), SAMPLE_SHELLCODE);
+        }
+    }
+    PIN_UnlockClient();
+}
+
+VOID InstrumentSampling(TRACE trace, VOID *v)
+{
+    ProfileScope scope(g_SelfProfile, PROF_INSTRUMENT_TRACE);
+    for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl)) {
+        BBL_InsertIfCall(bbl, IPOINT_BEFORE, (AFUNPTR)SampleCountdown,
+            IARG_FAST_ANALYSIS_CALL,
+            IARG_REG_VALUE, g_ThreadDataReg,
+            IARG_UINT32, BBL_NumIns(bbl),
+            IARG_END
+        );
+        BBL_InsertThenCall(bbl, IPOINT_BEFORE, (AFUNPTR)TakeSample,
+            IARG_REG_VALUE, g_ThreadDataReg,
+            IARG_INST_PTR,
+            IARG_END
+        );
+    }
+}
+
+/* ===================================================================== */
+// Transitions between the modules
+/* ===================================================================== */
+
+VOID PIN_FAST_ANALYSIS_CALL CountModuleTransition(const THREADID tid, const UINT32 fromId, const ADDRINT target)
+{
+    const UINT16 toId = g_ModuleIds.findId(target);
+    // within the same module: not a transition
+    if (toId == (UINT16)fromId) return;
+
+    ThreadData* data = getThreadData(tid);
+    if (!data) return;
+    if (!data->transitions) {
+        data->transitions = new TransitionMatrix();
+    }
+    data->transitions->add((UINT16)fromId, toId);
+}
+
+/* ===================================================================== */
+// Trace syscalls
+/* ===================================================================== */
+
+// Called before the syscall instruction that was found in the watched code
+VOID PIN_FAST_ANALYSIS_CALL WatchedSyscallCalled(const THREADID tid, const ADDRINT Address)
+{
+    ThreadData* data = getThreadData(tid);
+    if (!data) return;
+    data->syscall.armed = Address;
+}
+
+VOID _LogSyscall(s_syscall_info &info, const ADDRINT* retVal)
+{
+    const ADDRINT Address = info.address;
+    const s_syscall* sys = syscalls::find(info.number);
+    const std::string name = (sys) ? sys->name : "";
+    if (pInfo.isMyAddress(Address)) {
+        const ADDRINT rva = addr_to_rva(Address); // convert to RVA
+        traceLog.logSyscall(pInfo.getLogBase(Address), rva, info.number, name, info.args, info.argsCount, retVal);
+    }
+    else {
+        const ADDRINT start = GetPageOfAddr(Address);
+        if (start != UNKNOWN_ADDR) {
+            traceLog.logSyscall(start, Address - start, info.number, name, info.args, info.argsCount, retVal);
+        }
+    }
+    info.isPending = false;
+    info.address = 0;
+}
+
+// Logs the syscall which never returned (i.e. NtContinue)
+VOID FlushPendingSyscall(ThreadData* data)
+{
+    if (!data || !data->syscall.isPending) return;
+
+    LockClient();
+    _LogSyscall(data->syscall, NULL);
+    PIN_UnlockClient();
+}
+
+VOID SyscallEntry(THREADID tid, CONTEXT *ctxt, SYSCALL_STANDARD std, VOID *v)
+{
+    ProfileScope scope(g_SelfProfile, PROF_SYSCALL);
+    ThreadData* data = getThreadData(tid);
+    if (!data || (!data->syscall.armed && !data->syscall.isPending)) return;
+
+    FlushPendingSyscall(data);
+
+    s_syscall_info &info = data->syscall;
+    const ADDRINT Address = (ADDRINT)PIN_GetContextReg(ctxt, REG_INST_PTR);
+    // the syscall was issued by one of the system libraries: nothing more to do
+    if (info.armed != Address) return;
+
+    info.armed = 0;
+    info.address = Address;
+    info.number = PIN_GetSyscallNumber(ctxt, std);
+
+    const s_syscall* sys = syscalls::find(info.number);
+    // if the syscall is unknown, save only the arguments passed via registers
+    info.argsCount = (sys) ? sys->argsCount : 4;
+    if (info.argsCount > SYSCALL_ARGS_MAX) {
+        info.argsCount = SYSCALL_ARGS_MAX;
+    }
+    for (UINT32 i = 0; i < info.argsCount; i++) {
+        info.args[i] = PIN_GetSyscallArgument(ctxt, std, i);
+    }
+    info.isPending = true;
+}
+
+VOID SyscallExit(THREADID tid, CONTEXT *ctxt, SYSCALL_STANDARD std, VOID *v)
+{
+    ProfileScope scope(g_SelfProfile, PROF_SYSCALL);
+    ThreadData* data = getThreadData(tid);
+    if (!data || !data->syscall.isPending) return;
+
+    const ADDRINT retVal = PIN_GetSyscallReturn(ctxt, std);
+
+    LockClient();
+    _LogSyscall(data->syscall, &retVal);
+    PIN_UnlockClient();
+}
+
+/* ===================================================================== */
+// Instrument functions arguments
+/* ===================================================================== */
+
+bool isWatchedAddress(const ADDRINT Address)
+{
+    IMG currModule = IMG_FindByAddress(Address);
+    const bool isCurrMy = pInfo.isMyAddress(Address);
+    if (isCurrMy) {
+        return true;
+    }
+    if (m_FollowShellcode && !IMG_Valid(currModule)) {
+        const ADDRINT start = GetPageOfAddr(Address);
+        ADDRINT rva = Address - start;
+        if (start != UNKNOWN_ADDR) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#define BACKTRACE_MAX 8
+
+// print the return addresses stored in the shadow stack, starting from the most recent call
+VOID backtraceToStr(const ShadowStack &stack, std::wstringstream &ss)
+{
+    const size_t depth = stack.depth();
+    for (size_t i = 0; i < stack.stored() && i < BACKTRACE_MAX; i++) {
+        const s_frame* frame = stack.getFrame(i);
+        const ADDRINT retAddr = frame->retAddr;
+        ss << "\tFrame[" << std::dec << (depth - i) << "] = ";
+        if (pInfo.isMyAddress(retAddr)) {
+            const ADDRINT base = pInfo.getLogBase(retAddr);
+            if (base) {
+                ss << std::hex << base << "+";
+            }
+            ss << std::hex << addr_to_rva(retAddr);
+        }
+        else {
+            const ADDRINT start = GetPageOfAddr(retAddr);
+            ss << std::hex << start << "+" << (retAddr - start);
+        }
+        ss << "\n";
+    }
+}
+
+VOID _LogFunctionArgs(const THREADID tid, const UINT32 funcId, const ADDRINT stackPtr, const ADDRINT Address, CHAR *name, uint32_t argCount, VOID *arg1, VOID *arg2, VOID *arg3, VOID *arg4, VOID *arg5, VOID *arg6, VOID *arg7, VOID *arg8, VOID *arg9, VOID *arg10)
+{
+    if (!isWatchedAddress(Address)) return;
+
+    const size_t argsMax = 10;
+    VOID* args[argsMax] = { arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9, arg10 };
+    std::wstringstream ss;
+    for (size_t i = 0; i < argCount && i < argsMax; i++) {
+        ss << "\tArg[" << i << "] = ";
+        ss << paramToStr(args[i]);
+        ss << "\n";
+    }
+    if (m_ShadowStack) {
+        const ThreadData* data = getThreadData(tid);
+        if (data) {
+            backtraceToStr(data->stack, ss);
+        }
+    }
+
+    std::wstring argsLineW = ss.str();
+    std::string s(argsLineW.begin(), argsLineW.end());
+    traceLog.logFunctionArgs(s);
+
+    // save the arguments that are going to be read after the function returns
+    if (funcId < g_Watch.funcs.size() && (g_Watch.funcs[funcId].isPostCapture() || m_Latency)) {
+        ThreadData* data = getThreadData(tid);
+        if (data) {
+            s_pending_call call;
+            call.funcId = funcId;
+            call.retAddr = Address;
+            call.stackPtr = stackPtr;
+            for (size_t i = 0; i < WATCHED_ARGS_MAX; i++) {
+                call.args[i] = (ADDRINT)args[i];
+            }
+            // take the timestamp as late as possible, so that the logging is not measured
+            call.startTime = util::getTimestamp();
+            if (!data->pushPendingCall(call)) {
+                g_LiveStatus.addDropped(1);
+            }
+            g_LiveStatus.setPendingCalls(tid, data->pendingCount, PENDING_CALLS_MAX);
+        }
+    }
+}
+
+VOID LogFunctionArgs(const THREADID tid, const UINT32 funcId, const ADDRINT stackPtr, const ADDRINT Address, CHAR *name, uint32_t argCount, VOID *arg1, VOID *arg2, VOID *arg3, VOID *arg4, VOID *arg5, VOID *arg6, VOID *arg7, VOID *arg8, VOID *arg9, VOID *arg10)
+{
+    ProfileScope scope(g_SelfProfile, PROF_FUNC_ARGS);
+    LockClient();
+    if (m_Record) {
+        VOID* args[] = { arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9, arg10 };
+        const UINT32 argsMax = sizeof(args) / sizeof(args[0]);
+        g_Replay.recordFuncArgs(tid, funcId, stackPtr, Address, name, (argCount < argsMax) ? argCount : argsMax, args);
+    }
+    _LogFunctionArgs(tid, funcId, stackPtr, Address, name, argCount, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9, arg10);
+    PIN_UnlockClient();
+}
+
+#define OUT_BYTES_MAX 128
+
+// get the buffer of the out-parameter, and its declared size
+bool resolveOutParam(const OutParam &param, const s_pending_call &call, ADDRINT &ptr, size_t &size)
+{
+    if (param.argIdx >= WATCHED_ARGS_MAX) {
+        return false;
+    }
+    ptr = call.args[param.argIdx];
+    size = sizeof(ADDRINT);
+    if (param.sizeType == OUT_SIZE_FIXED) {
+        size = param.size;
+    }
+    else if (param.sizeType == OUT_SIZE_ARG_VAL || param.sizeType == OUT_SIZE_ARG_PTR) {
+        if (param.size >= WATCHED_ARGS_MAX) {
+            return false;
+        }
+        size = call.args[param.size];
+        if (param.sizeType == OUT_SIZE_ARG_PTR) {
+            UINT32 sizeVal = 0;
+            if (!size || PIN_SafeCopy(&sizeVal, (VOID*)size, sizeof(sizeVal)) != sizeof(sizeVal)) {
+                return false;
+            }
+            size = sizeVal;
+        }
+    }
+    return true;
+}
+
+std::string outParamToStr(const OutParam &param, const s_pending_call &call)
+{
+    if (param.argIdx >= WATCHED_ARGS_MAX) {
+        return "";
+    }
+    std::stringstream ss;
+    ss << "\tOut[" << std::dec << param.argIdx << "] = ";
+    if (call.args[param.argIdx] == 0) {
+        ss << "0\n";
+        return ss.str();
+    }
+    ADDRINT ptr = 0;
+    size_t size = 0;
+    if (!resolveOutParam(param, call, ptr, size)) {
+        ss << "?\n";
+        return ss.str();
+    }
+    // copy only the declared bytes, within the limit
+    UINT8 buf[OUT_BYTES_MAX] = { 0 };
+    const size_t toCopy = (size < OUT_BYTES_MAX) ? size : OUT_BYTES_MAX;
+    const size_t copied = PIN_SafeCopy(buf, (VOID*)ptr, toCopy);
+
+    if (param.sizeType == OUT_SIZE_DEFAULT) {
+        if (copied != sizeof(ADDRINT)) {
+            ss << "?\n";
+            return ss.str();
+        }
+        ADDRINT val = 0;
+        ::memcpy(&val, buf, sizeof(ADDRINT));
+        ss << std::hex << val << "\n";
+        return ss.str();
+    }
+    ss << "[" << std::dec << size << "]";
+    for (size_t i = 0; i < copied; i++) {
+        ss << " " << std::hex << std::setw(2) << std::setfill('0') << (UINT32)buf[i];
+    }
+    if (copied < size) {
+        ss << " ...";
+    }
+    ss << " \"";
+    for (size_t i = 0; i < copied; i++) {
+        ss << (IS_PRINTABLE(buf[i]) ? (char)buf[i] : '.');
+    }
+    ss << "\"\n";
+    return ss.str();
+}
+
+VOID _LogFunctionRet(const s_pending_call &call, const ADDRINT retVal)
+{
+    const WFuncInfo &info = g_Watch.funcs[call.funcId];
+    // the name must identify the function: both of its parts are required
+    if (!info.isValid()) return;
+
+    std::stringstream ss;
+    if (info.captureRet) {
+        ss << "\tRet = " << std::hex << retVal << "\n";
+    }
+    for (size_t i = 0; i < info.outParams.size(); i++) {
+        ss << outParamToStr(info.outParams[i], call);
+    }
+    const std::string func = info.getName();
+    const ADDRINT Address = call.retAddr;
+    if (pInfo.isMyAddress(Address)) {
+        traceLog.logFunctionRet(pInfo.getLogBase(Address), addr_to_rva(Address), func, ss.str());
+    }
+    else {
+        const ADDRINT start = GetPageOfAddr(Address);
+        traceLog.logFunctionRet(start, Address - start, func, ss.str());
+    }
+}
+
+// the outputs of the watched function become the sources of the taint
+VOID TaintFunctionOutputs(ThreadData* data, const s_pending_call &call)
+{
+    const WFuncInfo &info = g_Watch.funcs[call.funcId];
+    const UINT8 label = (call.funcId < TAINT_LABEL_MAX) ? (UINT8)(call.funcId + 1) : TAINT_LABEL_MAX;
+    g_Shadow.activate();
+    if (info.captureRet) {
+        data->taint->setLabel(taint::regToMask(REG_GAX), label);
+    }
+    for (size_t i = 0; i < info.outParams.size(); i++) {
+        ADDRINT ptr = 0;
+        size_t size = 0;
+        if (resolveOutParam(info.outParams[i], call, ptr, size) && ptr) {
+            g_Shadow.set(ptr, size, label);
+        }
+    }
+}
+
+VOID LogFunctionRet(const THREADID tid, const UINT32 funcId, const ADDRINT retVal, const ADDRINT stackPtr)
+{
+    const UINT64 endTime = util::getTimestamp();
+
+    ProfileScope scope(g_SelfProfile, PROF_FUNC_RET);
+    ThreadData* data = getThreadData(tid);
+    // not called from the watched code
+    if (!data || !data->pendingCount) return;
+
+    s_pending_call call;
+    const bool isFound = data->popPendingCall(funcId, stackPtr, call);
+    g_LiveStatus.setPendingCalls(tid, data->pendingCount, PENDING_CALLS_MAX);
+    if (!isFound) return;
+
+    if (data->latency) {
+        data->latency->add(funcId, endTime - call.startTime);
+    }
+    if (!g_Watch.funcs[funcId].isPostCapture()) return;
+
+    if (data->taint) {
+        TaintFunctionOutputs(data, call);
+    }
+    LockClient();
+    _LogFunctionRet(call, retVal);
+    PIN_UnlockClient();
+}
+
+VOID MonitorFunctionArgs(IMG Image, const UINT32 funcId)
+{
+    const WFuncInfo &funcInfo = g_Watch.funcs[funcId];
+    const CHAR* fName = funcInfo.funcName.c_str();
+    size_t argNum = funcInfo.paramCount;
+    RTN funcRtn = RTN_FindByName(Image, fName);
+    if (!RTN_Valid(funcRtn) || !funcInfo.isValid()) return; // failed
+
+    std::cout << "Watch " << IMG_Name(Image) << ": " << fName << " [" << argNum << "]\n";
+    RTN_Open(funcRtn);
+
+    RTN_InsertCall(funcRtn, IPOINT_BEFORE, AFUNPTR(LogFunctionArgs),
+        IARG_THREAD_ID,
+        IARG_UINT32, funcId,
+        IARG_REG_VALUE, REG_STACK_PTR,
+        IARG_RETURN_IP,
+        IARG_ADDRINT, fName,
+        IARG_UINT32, argNum,
+        IARG_FUNCARG_ENTRYPOINT_VALUE, 0,
+        IARG_FUNCARG_ENTRYPOINT_VALUE, 1,
+        IARG_FUNCARG_ENTRYPOINT_VALUE, 2,
+        IARG_FUNCARG_ENTRYPOINT_VALUE, 3,
+        IARG_FUNCARG_ENTRYPOINT_VALUE, 4,
+        IARG_FUNCARG_ENTRYPOINT_VALUE, 5,
+        IARG_FUNCARG_ENTRYPOINT_VALUE, 6,
+        IARG_FUNCARG_ENTRYPOINT_VALUE, 7,
+        IARG_FUNCARG_ENTRYPOINT_VALUE, 8,
+        IARG_FUNCARG_ENTRYPOINT_VALUE, 9,
+        IARG_FUNCARG_ENTRYPOINT_VALUE, 10,
+        IARG_END
+    );
+
+    if (funcInfo.isPostCapture() || m_Latency) {
+        RTN_InsertCall(funcRtn, IPOINT_AFTER, AFUNPTR(LogFunctionRet),
+            IARG_THREAD_ID,
+            IARG_UINT32, funcId,
+            IARG_FUNCRET_EXITPOINT_VALUE,
+            IARG_REG_VALUE, REG_STACK_PTR,
+            IARG_END
+        );
+    }
+
+    RTN_Close(funcRtn);
+}
+
+
+/* ===================================================================== */
+// Coverage
+/* ===================================================================== */
+
+VOID PIN_FAST_ANALYSIS_CALL MarkBlock(UINT8* slot)
+{
+    *slot = 1;
+}
+
+// get ID of the module (or the shellcode page) to which the block belongs
+UINT16 getBlockModuleId(const ADDRINT Address)
+{
+    IMG img = IMG_FindByAddress(Address);
+    if (IMG_Valid(img)) {
+        return g_Blocks.addModule(get_mod_base(Address), IMG_HighAddress(img), IMG_Name(img), pInfo.isMyAddress(Address));
+    }
+    const ADDRINT start = GetPageOfAddr(Address);
+    std::stringstream ss;
+    ss << "shellcode_" << std::hex << start;
+    return g_Blocks.addModule(start, start + PAGE_SIZE, ss.str(), false);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL CountBlock(UINT64* counter)
+{
+    (*counter)++;
+}
+
+// write the profile of the executions as tags: the totals per section, and the most frequently executed blocks
+bool WriteHotBlocks(const std::string &fileName)
+{
+    std::ofstream file(fileName.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    std::map<ADDRINT, UINT64> sectionTotals; // executed instructions, by the (absolute) section start
+    for (size_t i = 0; i < g_Blocks.countBlocks(); i++) {
+        const s_block &block = g_Blocks.getBlock(i);
+        const s_cov_module &mod = g_Blocks.getModule(block.moduleId);
+        if (!mod.isTraced) continue;
+
+        const s_module* sec = pInfo.getSecByAddr(mod.base + block.start);
+        if (!sec) continue;
+        sectionTotals[mod.base + sec->start] += (*g_Blocks.getCounterSlot(i)) * block.insCount;
+    }
+    for (std::map<ADDRINT, UINT64>::iterator itr = sectionTotals.begin(); itr != sectionTotals.end(); ++itr) {
+        const ADDRINT base = pInfo.getLogBase(itr->first);
+        if (base) {
+            file << "> " << std::hex << base << "+";
+        }
+        file << std::hex << addr_to_rva(itr->first) << ";"
+            << "section: [" << pInfo.getSecName(itr->first) << "] executed: "
+            << std::dec << itr->second << " instructions"
+            << std::endl;
+    }
+
+    std::vector<size_t> hotBlocks;
+    g_Blocks.getHotBlocks(m_HotBlocks, hotBlocks);
+    for (size_t i = 0; i < hotBlocks.size(); i++) {
+        const s_block &block = g_Blocks.getBlock(hotBlocks[i]);
+        const s_cov_module &mod = g_Blocks.getModule(block.moduleId);
+        if (!mod.isTraced || pInfo.getLogBase(mod.base)) {
+            file << "> " << std::hex << mod.base << "+";
+        }
+        file << std::hex << block.start << ";"
+            << "hot: " << std::dec << (*g_Blocks.getCounterSlot(hotBlocks[i])) << " executions"
+            << " [" << block.insCount << " instructions]"
+            << std::endl;
+    }
+    return true;
+}
+
+/* ===================================================================== */
+// Instrumentation callbacks
+/* ===================================================================== */
+
+VOID InstrumentTrace(TRACE trace, VOID *v)
+{
+    ProfileScope scope(g_SelfProfile, PROF_INSTRUMENT_TRACE);
+    for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl)) {
+        const ADDRINT Address = BBL_Address(bbl);
+        if (!isWatchedAddress(Address)) continue;
+
+        const UINT16 moduleId = getBlockModuleId(Address);
+        const size_t index = g_Blocks.addBlock(Address, (UINT32)BBL_Size(bbl), BBL_NumIns(bbl), moduleId);
+        if (m_Coverage) {
+            BBL_InsertCall(bbl, IPOINT_ANYWHERE, (AFUNPTR)MarkBlock,
+                IARG_FAST_ANALYSIS_CALL,
+                IARG_PTR, g_Blocks.getHitSlot(index),
+                IARG_END
+            );
+        }
+        if (m_HotBlocks) {
+            BBL_InsertCall(bbl, IPOINT_ANYWHERE, (AFUNPTR)CountBlock,
+                IARG_FAST_ANALYSIS_CALL,
+                IARG_PTR, g_Blocks.getCounterSlot(index),
+                IARG_END
+            );
+        }
+    }
+}
+
+VOID InstrumentInstruction(INS ins, VOID *v)
+{
+    ProfileScope scope(g_SelfProfile, PROF_INSTRUMENT_INS);
+    if (isStrEqualI(INS_Mnemonic(ins), "cpuid")) {
+        INS_InsertCall(
+            ins,
+            IPOINT_BEFORE, (AFUNPTR)CpuidCalled,
+            IARG_CONTEXT,
+            IARG_END
+        );
+    }
+
+    if (INS_IsRDTSC(ins)) {
+        if (m_TraceRDTSC) {
+            INS_InsertCall(
+                ins,
+                IPOINT_BEFORE, (AFUNPTR)RdtscCalled,
+                IARG_CONTEXT,
+                IARG_END
+            );
+        }
+
+        INS_InsertCall(
+            ins, 
+            IPOINT_AFTER, (AFUNPTR)AlterRdtscValueEdx,
+            IARG_CONTEXT,
+            IARG_RETURN_REGS, 
+            REG_GDX,
+            IARG_END);
+
+        INS_InsertCall(ins, 
+            IPOINT_AFTER, (AFUNPTR)AlterRdtscValueEax,
+            IARG_CONTEXT,
+            IARG_RETURN_REGS,
+            REG_GAX,
+            IARG_END);
+    }
+
+    if (m_TraceSyscalls && INS_IsSyscall(ins) && isWatchedAddress(INS_Address(ins))) {
+        INS_InsertCall(
+            ins,
+            IPOINT_BEFORE, (AFUNPTR)WatchedSyscallCalled,
+            IARG_FAST_ANALYSIS_CALL,
+            IARG_THREAD_ID,
+            IARG_INST_PTR,
+            IARG_END
+        );
+    }
+
+    // update the shadow stack before the transition gets logged
+    if (m_ShadowStack && INS_IsControlFlow(ins) && isWatchedAddress(INS_Address(ins))) {
+        if (INS_IsCall(ins)) {
+            INS_InsertCall(
+                ins,
+                IPOINT_BEFORE, (AFUNPTR)ShadowStackCall,
+                IARG_FAST_ANALYSIS_CALL,
+                IARG_THREAD_ID,
+                IARG_ADDRINT, INS_NextAddress(ins),
+                IARG_REG_VALUE, REG_STACK_PTR,
+                IARG_END
+            );
+        }
+        else if (INS_IsRet(ins)) {
+            INS_InsertCall(
+                ins,
+                IPOINT_BEFORE, (AFUNPTR)ShadowStackRet,
+                IARG_FAST_ANALYSIS_CALL,
+                IARG_THREAD_ID,
+                IARG_REG_VALUE, REG_STACK_PTR,
+                IARG_END
+            );
+        }
+        else if (INS_IsIndirectControlFlow(ins)) {
+            // i.e. a jump to the imported function
+            INS_InsertCall(
+                ins,
+                IPOINT_BEFORE, (AFUNPTR)ShadowStackUnwind,
+                IARG_FAST_ANALYSIS_CALL,
+                IARG_THREAD_ID,
+                IARG_REG_VALUE, REG_STACK_PTR,
+                IARG_END
+            );
+        }
+    }
+
+    if (m_MemWatch && INS_MemoryOperandCount(ins) && pInfo.isMyAddress(INS_Address(ins))) {
+        InstrumentMemAccess(ins);
+    }
+
+    // the returns only mirror the calls: not counted
+    if (m_ModuleMatrix && INS_IsIndirectControlFlow(ins) && !INS_IsRet(ins)) {
+        // the source is known at the instrumentation time
+        const UINT16 fromId = g_ModuleIds.findId(INS_Address(ins));
+        INS_InsertCall(
+            ins,
+            IPOINT_BEFORE, (AFUNPTR)CountModuleTransition,
+            IARG_FAST_ANALYSIS_CALL,
+            IARG_THREAD_ID,
+            IARG_UINT32, (UINT32)fromId,
+            IARG_BRANCH_TARGET_ADDR,
+            IARG_END
+        );
+    }
+
+    if (m_Taint && pInfo.isMyAddress(INS_Address(ins))) {
+        InstrumentTaint(ins);
+    }
+
+    if (m_BranchTrace && INS_IsControlFlow(ins) && isWatchedAddress(INS_Address(ins))) {
+        addBranchModule(INS_Address(ins));
+        if (INS_IsBranch(ins) && INS_HasFallThrough(ins) && !INS_IsIndirectControlFlow(ins)) {
+            // conditional: only the outcome is saved
+            INS_InsertCall(
+                ins,
+                IPOINT_BEFORE, (AFUNPTR)BranchCond,
+                IARG_FAST_ANALYSIS_CALL,
+                IARG_THREAD_ID,
+                IARG_INST_PTR,
+                IARG_BRANCH_TAKEN,
+                IARG_END
+            );
+        }
+        else if (INS_IsIndirectControlFlow(ins)) {
+            INS_InsertCall(
+                ins,
+                IPOINT_BEFORE, (AFUNPTR)BranchIndirect,
+                IARG_FAST_ANALYSIS_CALL,
+                IARG_THREAD_ID,
+                IARG_INST_PTR,
+                IARG_BRANCH_TARGET_ADDR,
+                IARG_END
+            );
+        }
+        else if (INS_IsDirectControlFlow(ins) && !isWatchedAddress(INS_DirectControlFlowTargetAddress(ins))) {
+            // the target is known from the code, but the tracing needs to resync after the return
+            INS_InsertCall(
+                ins,
+                IPOINT_BEFORE, (AFUNPTR)BranchLeave,
+                IARG_FAST_ANALYSIS_CALL,
+                IARG_THREAD_ID,
+                IARG_END
+            );
+        }
+    }
+
+    if ((INS_IsControlFlow(ins) || INS_IsFarJump(ins))) {
+        INS_InsertCall(
+            ins, 
+            IPOINT_BEFORE, (AFUNPTR)SaveTransitions,
+            IARG_INST_PTR,
+            IARG_BRANCH_TARGET_ADDR,
+            IARG_END
+        );
     }
 }
 
 VOID ImageLoad(IMG Image, VOID *v)
 {
-    PIN_LockClient();
+    ProfileScope scope(g_SelfProfile, PROF_IMAGE);
+    LockClient();
+    if (m_Record) {
+        g_Replay.recordImageLoad(Image);
+    }
     pInfo.addModule(Image);
+    if (m_ModuleMatrix) {
+        const bool wasFull = g_ModuleIds.countOverLimit() > 0;
+        g_ModuleIds.addModule(IMG_LowAddress(Image), IMG_HighAddress(Image), IMG_Name(Image));
+        if (!wasFull && g_ModuleIds.countOverLimit()) {
+            std::cerr << "Too many modules for the transitions matrix: the next ones are counted as unknown, starting from: " << IMG_Name(Image) << std::endl;
+        }
+    }
+    const s_traced_module* mainModule = pInfo.getMainModule();
+    if (m_MemWatch && mainModule && IMG_LoadOffset(Image) == mainModule->base) {
+        g_MemRanges.resolve(IMG_LoadOffset(Image));
+    }
     for (size_t i = 0; i < g_Watch.funcs.size(); i++) {
         const std::string dllName = util::getDllName(IMG_Name(Image));
         if (util::iequals(dllName, g_Watch.funcs[i].dllName)) {
-            MonitorFunctionArgs(Image, g_Watch.funcs[i]);
+            MonitorFunctionArgs(Image, (UINT32)i);
         }
     }
     PIN_UnlockClient();
 }
 
+VOID ImageUnload(IMG Image, VOID *v)
+{
+    ProfileScope scope(g_SelfProfile, PROF_IMAGE);
+    LockClient();
+    if (m_Record) {
+        g_Replay.recordImageUnload(Image);
+    }
+    pInfo.removeModule(Image);
+    if (m_ModuleMatrix) {
+        g_ModuleIds.removeModule(IMG_LowAddress(Image));
+    }
+    PIN_UnlockClient();
+}
+
+VOID ThreadStart(THREADID tid, CONTEXT *ctxt, INT32 flags, VOID *v)
+{
+    if (m_Record) {
+        g_Replay.recordThread(REC_THREAD_START, tid);
+    }
+    g_LiveStatus.setThreadAlive(tid, true);
+    ThreadData* data = new ThreadData();
+    if (m_Latency) {
+        data->latency = new LatencyStats(g_Watch.funcs.size());
+    }
+    if (m_CallGraph) {
+        data->edges = new EdgeTable();
+    }
+    if (g_Fingerprint) {
+        data->ngrams = new NgramCounter(KnobNgrams.Value());
+    }
+    if (m_BranchTrace) {
+        data->branches = new BranchBuffer(g_BranchTrace, tid);
+    }
+    if (m_MemWatch) {
+        data->memAccess = new MemAccessBuffer();
+    }
+    if (m_Taint) {
+        data->taint = new s_taint_regs();
+    }
+    if (m_SamplePeriod) {
+        data->sampleCountdown = m_SamplePeriod;
+        PIN_SetContextReg(ctxt, g_ThreadDataReg, (ADDRINT)data);
+    }
+    PIN_SetThreadData(tls_key, data, tid);
+}
+
+VOID ThreadFini(THREADID tid, const CONTEXT *ctxt, INT32 code, VOID *v)
+{
+    ThreadData* data = getThreadData(tid);
+    FlushPendingSyscall(data);
+    if (data && data->latency && g_Latency) {
+        PIN_LockClient();
+        g_Latency->merge(*data->latency);
+        PIN_UnlockClient();
+    }
+    if (data && data->edges) {
+        PIN_LockClient();
+        g_CallGraph.merge(*data->edges);
+        PIN_UnlockClient();
+    }
+    if (data && data->transitions && g_Transitions) {
+        PIN_LockClient();
+        g_Transitions->merge(*data->transitions);
+        PIN_UnlockClient();
+    }
+    if (data && data->ngrams && g_Fingerprint) {
+        PIN_LockClient();
+        g_Fingerprint->merge(*data->ngrams);
+        PIN_UnlockClient();
+    }
+    if (data && data->branches) {
+        data->branches->flush();
+    }
+    FlushMemAccess(data);
+    PIN_SetThreadData(tls_key, NULL, tid);
+    delete data;
+    g_LiveStatus.setThreadAlive(tid, false);
+
+    if (m_Record) {
+        g_Replay.recordThread(REC_THREAD_FINI, tid);
+    }
+}
+
+// get the name of the output of the child process: <output>.<pid>.<ext>
+std::string getChildOutputName(const std::string &fileName, const INT pid)
+{
+    std::stringstream ss;
+    ss << "." << std::dec << pid;
+    const size_t sep = fileName.find_last_of("/\\");
+    const size_t ext = fileName.find_last_of(".");
+    if (ext == std::string::npos || (sep != std::string::npos && ext < sep)) {
+        return fileName + ss.str();
+    }
+    return fileName.substr(0, ext) + ss.str() + fileName.substr(ext);
+}
+
+// get the name of the file written by this process: the child gets the same options as its parent, so each of its outputs is renamed
+std::string getOutputName(const std::string &fileName)
+{
+    if (KnobParentPid.Value() == 0) {
+        return fileName;
+    }
+    return getChildOutputName(fileName, PIN_GetPid());
+}
+
+VOID Fini(INT32 code, VOID *v)
+{
+    if (m_Record) {
+        g_Replay.close();
+    }
+    if (KnobFollowChild.Value()) {
+        g_ProcIndex.logStop(code);
+    }
+    if (g_Recorder) {
+        PIN_LockClient();
+        traceLog.dumpRecorder("exit");
+        PIN_UnlockClient();
+    }
+    if (g_Baseline) {
+        PIN_LockClient();
+        if (g_Baseline->countLoaded()) {
+            std::cerr << "Events suppressed by the baseline: " << std::dec << g_Baseline->countSuppressed() << std::endl;
+        }
+        const std::string baselineFile = KnobBaselineOut.Value().length() ? getOutputName(KnobBaselineOut.Value()) : "";
+        if (baselineFile.length() && g_Baseline->save(baselineFile)) {
+            std::cerr << "Baseline saved to: " << baselineFile << std::endl;
+        }
+        PIN_UnlockClient();
+    }
+    if (g_Timeline) {
+        PIN_LockClient();
+        g_Timeline->close();
+        PIN_UnlockClient();
+    }
+    if (m_BranchTrace) {
+        if (g_BranchTrace.close()) {
+            std::cerr << "Branch trace saved to: " << traceLog.getFileName() << ".bt" << std::endl;
+        }
+    }
+    if (g_Transitions) {
+        const std::string matrixFile = traceLog.getFileName() + ".matrix";
+        if (g_Transitions->write(matrixFile, g_ModuleIds)) {
+            std::cerr << "Transitions between the modules saved to: " << matrixFile << std::endl;
+        }
+    }
+    if (m_SamplePeriod) {
+        const std::string profFile = traceLog.getFileName() + ".prof";
+        if (g_Profile.write(profFile, m_SamplePeriod)) {
+            std::cerr << "Sampled profile saved to: " << profFile << std::endl;
+        }
+    }
+    if (g_Latency) {
+        const std::string latFile = traceLog.getFileName() + ".lat";
+        if (g_Latency->writeReport(latFile, g_Watch)) {
+            std::cerr << "Durations of the watched functions saved to: " << latFile << std::endl;
+        }
+    }
+    if (m_Coverage) {
+        const std::string covFile = traceLog.getFileName() + ".drcov";
+        if (g_Blocks.writeDrcov(covFile)) {
+            std::cerr << "Coverage saved to: " << covFile << std::endl;
+        }
+    }
+    if (m_HotBlocks) {
+        const std::string hotFile = traceLog.getFileName() + ".hot.tag";
+        if (WriteHotBlocks(hotFile)) {
+            std::cerr << "Profile of the executions saved to: " << hotFile << std::endl;
+        }
+    }
+    if (g_Fingerprint) {
+        const std::string ngramsFile = traceLog.getFileName() + ".ngrams";
+        if (g_Fingerprint->write(ngramsFile)) {
+            std::cerr << "Fingerprint of the API calls saved to: " << ngramsFile << std::endl;
+        }
+    }
+    if (m_CallGraph) {
+        const std::string dotFile = traceLog.getFileName() + ".dot";
+        const std::string jsonFile = traceLog.getFileName() + ".json";
+        if (g_CallGraph.writeDot(dotFile) && g_CallGraph.writeJson(jsonFile)) {
+            std::cerr << "Call graph saved to: " << dotFile << ", " << jsonFile << std::endl;
+        }
+    }
+    if (g_SelfProfile) {
+        const std::string statsFile = traceLog.getFileName() + ".stats";
+        if (g_SelfProfile->writeReport(statsFile)) {
+            std::cerr << "Self-profile of the tool saved to: " << statsFile << std::endl;
+        }
+    }
+    g_LiveStatus.close();
+}
+
+BOOL FollowChild(CHILD_PROCESS child, VOID *v)
+{
+    std::stringstream ss;
+    ss << std::dec << PIN_GetPid();
+    const std::string parentPid = ss.str();
+
+    std::vector<const CHAR*> args;
+    for (size_t i = 0; i < g_PinArgs.size(); i++) {
+        args.push_back(g_PinArgs[i].c_str());
+    }
+    args.push_back("-parent_pid");
+    args.push_back(parentPid.c_str());
+    args.push_back("--");
+    CHILD_PROCESS_SetPinCommandLine(child, (INT)args.size(), &args[0]);
+
+    std::cerr << "Following the child process: " << std::dec << CHILD_PROCESS_GetId(child) << std::endl;
+    return true;
+}
+
 static void OnCtxChange(THREADID threadIndex,
     CONTEXT_CHANGE_REASON reason,
     const CONTEXT *ctxtFrom,
@@ -465,6 +1945,13 @@ static void OnCtxChange(THREADID threadIndex,
     INT32 info,
     VOID *v)
 {
+    if (g_Recorder && (reason == CONTEXT_CHANGE_REASON_EXCEPTION || reason == CONTEXT_CHANGE_REASON_FATALSIGNAL)) {
+        std::stringstream ss;
+        ss << "exception: " << std::hex << info;
+        PIN_LockClient();
+        traceLog.dumpRecorder(ss.str());
+        PIN_UnlockClient();
+    }
     if (ctxtTo == NULL || ctxtFrom == NULL) return;
 
     PIN_LockClient();
@@ -493,12 +1980,29 @@ int main(int argc, char *argv[])
         return Usage();
     }
 
-    std::string app_name = KnobModuleName.Value();
-    if (app_name.length() == 0) {
-        // init App Name:
+    const bool isChild = (KnobParentPid.Value() != 0);
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--") == 0) break;
+        if (strcmp(argv[i], "-parent_pid") == 0) {
+            i++; // set separately for each child
+            continue;
+        }
+        g_PinArgs.push_back(argv[i]);
+    }
+
+    std::string app_name;
+    for (UINT32 i = 0; i < KnobModuleName.NumberOfValues(); i++) {
+        if (KnobModuleName.Value(i).empty()) continue;
+        if (app_name.length()) {
+            app_name += ",";
+        }
+        app_name += KnobModuleName.Value(i);
+    }
+    if (app_name.length() == 0 || isChild) {
+        // init App Name (the child traces its own executable, along with the modules given by the parent):
         for (int i = 1; i < (argc - 1); i++) {
             if (strcmp(argv[i], "--") == 0) {
-                app_name = argv[i + 1];
+                app_name = (app_name.length()) ? (app_name + "," + argv[i + 1]) : argv[i + 1];
                 break;
             }
         }
@@ -515,25 +2019,158 @@ int main(int argc, char *argv[])
     }
 
     // init output file:
-    traceLog.init(KnobOutputFile.Value(), KnobShortLog.Value());
+    const std::string rootOutput = KnobOutputFile.Value().length() ? KnobOutputFile.Value() : "output.txt";
+    traceLog.init(getOutputName(rootOutput), KnobShortLog.Value());
+    if (KnobFollowChild.Value()) {
+        g_ProcIndex.init(rootOutput + ".procs", PIN_GetPid());
+        g_ProcIndex.logStart(KnobParentPid.Value(), traceLog.getFileName(), app_name);
+    }
     m_FollowShellcode = ConvertShcOption(KnobFollowShellcode.Value());
     m_TraceRDTSC = KnobTraceRDTSC.Value();
+    m_TraceSyscalls = KnobTraceSyscalls.Value();
+    m_ShadowStack = KnobShadowStack.Value();
+    m_Taint = KnobTaint.Value();
+    m_ModuleMatrix = KnobModuleMatrix.Value();
+    if (m_ModuleMatrix) {
+        g_Transitions = new TransitionMatrix();
+    }
+    if (KnobSample.Value() > 0) {
+        g_ThreadDataReg = PIN_ClaimToolRegister();
+        if (REG_valid(g_ThreadDataReg)) {
+            m_SamplePeriod = KnobSample.Value();
+        }
+        else {
+            std::cerr << "Cannot claim the tool register: sampling disabled" << std::endl;
+        }
+    }
+    m_Latency = KnobLatency.Value();
+    m_CallGraph = KnobCallGraph.Value();
+    m_Coverage = KnobCoverage.Value();
+    m_HotBlocks = (KnobHotBlocks.Value() > 0) ? KnobHotBlocks.Value() : 0;
+    if (m_HotBlocks) {
+        g_Blocks.enableCounters();
+    }
+    if (KnobNgrams.Value() > 0) {
+        g_Fingerprint = new ApiFingerprint(KnobNgrams.Value());
+    }
+    if (KnobTimeline.Value()) {
+        g_Timeline = new TimelineLog();
+        if (g_Timeline->init(traceLog.getFileName() + ".timeline.json")) {
+            traceLog.setTimeline(g_Timeline);
+        }
+    }
+    if (KnobBaseline.Value().length() || KnobBaselineOut.Value().length()) {
+        g_Baseline = new EventBaseline();
+        if (KnobBaseline.Value().length() && !g_Baseline->load(KnobBaseline.Value())) {
+            std::cerr << "Cannot load the baseline: " << KnobBaseline.Value() << std::endl;
+        }
+        if (KnobBaselineOut.Value().length()) {
+            if (!g_Baseline->countLoaded()) {
+                g_Baseline->setWithRva(KnobBaselineRva.Value());
+            }
+            g_Baseline->enableCollecting();
+        }
+        traceLog.setBaseline(g_Baseline, getCallerName);
+    }
+    if (KnobFlightRecorder.Value() > 0) {
+        g_Recorder = new FlightRecorder(KnobFlightRecorder.Value());
+        for (UINT32 i = 0; i < KnobFlightTrigger.NumberOfValues(); i++) {
+            g_Recorder->addTrigger(KnobFlightTrigger.Value(i));
+        }
+        traceLog.setRecorder(g_Recorder);
+    }
+    for (UINT32 i = 0; i < KnobMemRanges.NumberOfValues(); i++) {
+        if (g_MemRanges.parse(KnobMemRanges.Value(i))) {
+            m_MemWatch = true;
+        }
+        else {
+            std::cerr << "Invalid memory range: " << KnobMemRanges.Value(i) << std::endl;
+        }
+    }
+    if (m_MemWatch) {
+        traceLog.setPendingFlush(FlushMemAccessBeforeEvent);
+    }
+    if (KnobBranchTrace.Value()) {
+        m_BranchTrace = g_BranchTrace.init(traceLog.getFileName() + ".bt");
+        if (!m_BranchTrace) {
+            std::cerr << "Cannot create the branch trace file" << std::endl;
+        }
+    }
+    if (m_Latency) {
+        g_Latency = new LatencyStats(g_Watch.funcs.size());
+    }
+    if (KnobSelfProfile.Value()) {
+        g_SelfProfile = new SelfProfile();
+        traceLog.setProfile(g_SelfProfile);
+    }
+    if (KnobLiveStatus.Value()) {
+        if (g_LiveStatus.init(traceLog.getFileName() + ".live")) {
+            traceLog.setStatus(&g_LiveStatus);
+        }
+        else {
+            std::cerr << "Cannot create the status file" << std::endl;
+        }
+    }
+    if (KnobRecord.Value().length()) {
+        const std::string recordFile = getOutputName(KnobRecord.Value());
+        m_Record = g_Replay.init(recordFile, g_PinArgs);
+        if (!m_Record) {
+            std::cerr << "Cannot create the recording: " << recordFile << std::endl;
+        }
+    }
+
+    tls_key = PIN_CreateThreadDataKey(NULL);
+    if (tls_key == INVALID_TLS_KEY) {
+        std::cerr << "Cannot allocate the TLS key" << std::endl;
+        return 1;
+    }
+    if (m_TraceSyscalls && !syscalls::init()) {
+        std::cerr << "Syscalls table not available for this OS build: only the numbers will be logged" << std::endl;
+    }
 
     // Register function to be called for every loaded module
     IMG_AddInstrumentFunction(ImageLoad, NULL);
 
+    IMG_AddUnloadFunction(ImageUnload, NULL);
+
     // Register function to be called before every instruction
     INS_AddInstrumentFunction(InstrumentInstruction, NULL);
 
+    // Register function to be called for every trace (only if the blocks are needed)
+    if (m_Coverage || m_HotBlocks) {
+        TRACE_AddInstrumentFunction(InstrumentTrace, NULL);
+    }
+
+    // Register function to be called for every trace (sampling the executed addresses)
+    if (m_SamplePeriod) {
+        TRACE_AddInstrumentFunction(InstrumentSampling, NULL);
+    }
+
+    if (KnobFollowChild.Value()) {
+        PIN_AddFollowChildProcessFunction(FollowChild, NULL);
+    }
+
     // Register context changes
     PIN_AddContextChangeFunction(OnCtxChange, NULL);
 
+    // Register functions to be called at the thread start/end
+    PIN_AddThreadStartFunction(ThreadStart, NULL);
+    PIN_AddThreadFiniFunction(ThreadFini, NULL);
+
+    // Register function to be called when the application exits
+    PIN_AddFiniFunction(Fini, NULL);
+
+    if (m_TraceSyscalls) {
+        PIN_AddSyscallEntryFunction(SyscallEntry, NULL);
+        PIN_AddSyscallExitFunction(SyscallExit, NULL);
+    }
+
     std::cerr << "===============================================" << std::endl;
     std::cerr << "This application is instrumented by " << TOOL_NAME << " v." << VERSION << std::endl;
     std::cerr << "Tracing module: " << app_name << std::endl;
     if (!KnobOutputFile.Value().empty())
     {
-        std::cerr << "See file " << KnobOutputFile.Value() << " for analysis results" << std::endl;
+        std::cerr << "See file " << traceLog.getFileName() << " for analysis results" << std::endl;
     }
     std::cerr << "===============================================" << std::endl;
 
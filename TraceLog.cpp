@@ -4,69 +4,97 @@
 
 #include "Util.h"
 
-void TraceLog::logCall(const ADDRINT prevModuleBase, const ADDRINT prevAddr, bool isRVA, const std::string module, const std::string func)
+void TraceLog::logCall(const ADDRINT prevModuleBase, const ADDRINT prevAddr, bool isRVA, const std::string module, const std::string func, const int depth)
 {
     if (!createFile()) return;
     ADDRINT rva = (isRVA) ? prevAddr : prevAddr - prevModuleBase;
     if (!isRVA) {
-        m_traceFile << "> " << prevModuleBase << "+";
+        m_line << "> " << std::hex << prevModuleBase << "+";
     }
-    m_traceFile <<
+    m_line <<
         std::hex << rva
         << DELIMITER;
 
     if (!m_shortLog) {
-        m_traceFile << "called: "
+        m_line << "called: "
             << module;
     }
     else {
-        m_traceFile << util::getDllName(module);
+        m_line << util::getDllName(module);
     }
     if (func.length() > 0) {
-        m_traceFile << "." << func;
+        m_line << "." << func;
+    }
+    logDepth(depth);
+    m_line << std::endl;
+    // the path of the module and the depth may differ in the repacked sample
+    commitEvent((isRVA) ? 0 : prevModuleBase, rva, "called: " + util::getDllName(module) + "." + func);
+
+    if (m_timeline) {
+        m_timeline->logCall(PIN_ThreadId(), util::getDllName(module) + "." + func, (isRVA) ? 0 : prevModuleBase, rva);
+    }
+    if (m_recorder && func.length() && m_recorder->isTrigger(func)) {
+        dumpRecorder("called: " + func);
     }
-    m_traceFile << std::endl;
-    m_traceFile.flush();
 }
 
-void TraceLog::logCall(const ADDRINT prevBase, const ADDRINT prevAddr, const ADDRINT calledPageBase, const ADDRINT callAddr)
+void TraceLog::logCall(const ADDRINT prevBase, const ADDRINT prevAddr, const ADDRINT calledPageBase, const ADDRINT callAddr, const int depth)
 {
     if (!createFile()) return;
     if (prevBase) {
-        m_traceFile << "> " << prevBase << "+";
+        m_line << "> " << std::hex << prevBase << "+";
     }
     const ADDRINT rva = callAddr - calledPageBase;
-    m_traceFile << 
+    m_line << 
         std::hex << prevAddr 
         << DELIMITER 
-        << "called: ?? [" << calledPageBase << "+" << rva << "]"
-        << std::endl;
-    m_traceFile.flush();
+        << "called: ?? [" << std::hex << calledPageBase << "+" << rva << "]";
+    logDepth(depth);
+    m_line << std::endl;
+    // the address of the shellcode changes between the runs
+    commitEvent(prevBase, prevAddr, "called: ??");
+
+    if (m_timeline) {
+        std::stringstream ss;
+        ss << "shellcode_" << std::hex << calledPageBase;
+        m_timeline->logCall(PIN_ThreadId(), ss.str(), prevBase, prevAddr);
+    }
 }
 
-void TraceLog::logSectionChange(const ADDRINT prevAddr, std::string name)
+void TraceLog::logSectionChange(const ADDRINT base, const ADDRINT prevAddr, std::string name)
 {
     if (!createFile()) return;
-    m_traceFile 
+    if (base) {
+        m_line << "> " << std::hex << base << "+";
+    }
+    m_line 
         << std::hex << prevAddr 
         << DELIMITER 
         << "section: [" << name << "]"
         << std::endl;
-    m_traceFile.flush();
+    commitLine();
+
+    if (m_timeline) {
+        m_timeline->logSection(PIN_ThreadId(), name);
+    }
 }
 
 void TraceLog::logRdtsc(const ADDRINT base, const ADDRINT rva)
 {
     if (!createFile()) return;
     if (base) {
-        m_traceFile << "> " << std::hex << base << "+";
+        m_line << "> " << std::hex << base << "+";
     }
-    m_traceFile
+    m_line
         << std::hex << rva
         << DELIMITER
         << "RDTSC"
         << std::endl;
-    m_traceFile.flush();
+    commitEvent(base, rva);
+
+    if (m_timeline) {
+        m_timeline->logCounter(PIN_ThreadId(), COUNTER_RDTSC);
+    }
 }
 
 
@@ -74,34 +102,226 @@ void TraceLog::logCpuid(const ADDRINT base, const ADDRINT rva, const ADDRINT par
 {
     if (!createFile()) return;
     if (base) {
-        m_traceFile << "> " << std::hex << base << "+";
+        m_line << "> " << std::hex << base << "+";
     }
-    m_traceFile
+    m_line
         << std::hex << rva
         << DELIMITER
         << "CPUID:"
         << std::hex << param
         << std::endl;
-    m_traceFile.flush();
+    commitEvent(base, rva);
+
+    if (m_timeline) {
+        m_timeline->logCounter(PIN_ThreadId(), COUNTER_CPUID);
+    }
+}
+
+void TraceLog::logSyscall(const ADDRINT base, const ADDRINT rva, const ADDRINT number, const std::string &name, const ADDRINT* args, size_t argsCount, const ADDRINT* retVal)
+{
+    if (!createFile()) return;
+    if (base) {
+        m_line << "> " << std::hex << base << "+";
+    }
+    m_line
+        << std::hex << rva
+        << DELIMITER
+        << "SYSCALL:0x"
+        << std::hex << number;
+    if (name.length() > 0) {
+        m_line << "(" << name << ")";
+    }
+    m_line << std::endl;
+    for (size_t i = 0; i < argsCount; i++) {
+        m_line << "\tArg[" << std::dec << i << "] = " << std::hex << args[i] << std::endl;
+    }
+    if (retVal) {
+        m_line << "\tRet = " << std::hex << *retVal << std::endl;
+    }
+    commitEvent(base, rva);
+}
+
+void TraceLog::logFunctionRet(const ADDRINT base, const ADDRINT rva, const std::string &func, const std::string &values)
+{
+    if (!createFile()) return;
+    if (base) {
+        m_line << "> " << std::hex << base << "+";
+    }
+    m_line
+        << std::hex << rva
+        << DELIMITER
+        << "returned: " << func
+        << std::endl
+        << values;
+    commitEvent(base, rva);
+}
+
+void TraceLog::logTaintedBranch(const ADDRINT base, const ADDRINT rva, const std::string &source)
+{
+    if (!createFile()) return;
+    if (base) {
+        m_line << "> " << std::hex << base << "+";
+    }
+    m_line
+        << std::hex << rva
+        << DELIMITER
+        << "tainted branch: " << source
+        << std::endl;
+    commitEvent(base, rva);
+}
+
+void TraceLog::logMemAccess(const ADDRINT base, const ADDRINT rva, const bool isWrite, const ADDRINT addr, const UINT32 size, const UINT32 count)
+{
+    if (!createFile()) return;
+    if (base) {
+        m_line << "> " << std::hex << base << "+";
+    }
+    m_line
+        << std::hex << rva
+        << DELIMITER
+        << "mem " << (isWrite ? "W" : "R") << ": "
+        << std::hex << addr
+        << " [size=" << std::dec << size << "]";
+    if (count > 1) {
+        m_line << " [count=" << std::dec << count << "]";
+    }
+    m_line << std::endl;
+    commitEvent(base, rva);
+}
+
+void TraceLog::commitEvent(const ADDRINT base, const ADDRINT rva, const std::string &key)
+{
+    if (!m_baseline) {
+        commitLine();
+        return;
+    }
+    const std::string line = m_line.str();
+    std::string event = key;
+    if (event.empty()) {
+        // the addresses change between the runs: the caller is identified by its name instead
+        const size_t start = line.find(DELIMITER);
+        event = (start == std::string::npos) ? line : line.substr(start + 1);
+    }
+    const THREADID tid = PIN_ThreadId();
+    const bool withRva = m_baseline->isWithRva();
+    const std::string caller = m_callerName ? m_callerName(base, rva, withRva) : "";
+    if (!m_baseline->checkEvent(tid, caller, rva, event)) {
+        m_skippedEvents[tid] = line;
+        skipLine();
+        return;
+    }
+    m_skippedEvents.erase(tid);
+    commitLine();
+}
+
+void TraceLog::commitArgs()
+{
+    if (!m_baseline) {
+        commitLine();
+        return;
+    }
+    const THREADID tid = PIN_ThreadId();
+    if (!m_baseline->checkArgs(tid, m_line.str())) {
+        skipLine();
+        return;
+    }
+    std::map<THREADID, std::string>::iterator skipped = m_skippedEvents.find(tid);
+    if (skipped != m_skippedEvents.end()) {
+        // the call was seen in the reference run, but not with these arguments
+        const std::string args = m_line.str();
+        m_line.str(skipped->second);
+        m_skippedEvents.erase(skipped);
+        commitLine();
+        m_line << args;
+    }
+    commitLine();
+}
+
+void TraceLog::skipLine()
+{
+    if (m_profile) {
+        m_profile->addFiltered(PIN_ThreadId());
+    }
+    if (m_status) {
+        m_status->addFiltered();
+    }
+    resetLine();
+}
+
+void TraceLog::commitLine()
+{
+    if (m_flushPending && !m_isFlushing) {
+        // the buffered events are formatted in the same line stream: keep the current one aside
+        const std::string line = m_line.str();
+        const std::ios::fmtflags flags = m_line.flags();
+        resetLine();
+        m_isFlushing = true;
+        m_flushPending(PIN_ThreadId());
+        m_isFlushing = false;
+        m_line.str(line);
+        m_line.flags(flags);
+    }
+    const UINT64 start = m_profile ? util::getTimestamp() : 0;
+    if (m_recorder) {
+        const UINT64 dropped = m_recorder->countDropped();
+        m_recorder->record(PIN_ThreadId(), m_line.str());
+        if (m_status) {
+            m_status->addDropped((size_t)(m_recorder->countDropped() - dropped));
+            m_status->setRecorderFill(m_recorder->countHeld(), m_recorder->capacity());
+        }
+    }
+    else {
+        m_traceFile << m_line.str();
+        m_traceFile.flush();
+    }
+    if (m_profile) {
+        // the events kept by the flight recorder are counted as well: they are written only on demand
+        m_profile->addWrite(PIN_ThreadId(), m_line.str().length(), util::getTimestamp() - start);
+    }
+    if (m_status) {
+        // the events kept by the flight recorder are not written yet
+        m_status->addWrite(PIN_ThreadId(), m_recorder ? 0 : m_line.str().length());
+    }
+    resetLine();
+}
+
+void TraceLog::dumpRecorder(const std::string &reason)
+{
+    if (!m_recorder || !createFile()) return;
+    m_recorder->dump(m_traceFile, reason);
+    if (m_status) {
+        m_status->setRecorderFill(m_recorder->countHeld(), m_recorder->capacity());
+    }
+}
+
+void TraceLog::logFunctionArgs(const std::string &args)
+{
+    if (!createFile()) return;
+
+    m_line << args;
+    commitArgs();
 }
 
 void TraceLog::logLine(std::string str)
 {
     if (!createFile()) return;
 
-    m_traceFile
+    m_line
         << str
         << std::endl;
-    m_traceFile.flush();
+    commitLine();
 }
 
-void TraceLog::logNewSectionCalled(const ADDRINT prevAddr, std::string prevSection, std::string currSection)
+void TraceLog::logNewSectionCalled(const ADDRINT base, const ADDRINT prevAddr, std::string prevSection, std::string currSection)
 {
     createFile();
-    m_traceFile
+    if (base) {
+        m_line << "> " << std::hex << base << "+";
+    }
+    m_line
         << std::hex << prevAddr
         << DELIMITER
         << "[" << prevSection << "] -> [" << currSection << "]"
         << std::endl;
-    m_traceFile.flush();
+    commitLine();
 }
@@ -3,11 +3,28 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <map>
+
+#include "TimelineLog.h"
+#include "FlightRecorder.h"
+#include "EventBaseline.h"
+#include "SelfProfile.h"
+#include "LiveStatus.h"
+
+#define DEPTH_UNKNOWN (-1)
+
+// gives the short name of the calling module (optionally, with its section) by the logged address, to be matched against the baseline
+typedef std::string (*t_caller_name)(const ADDRINT base, const ADDRINT rva, const bool withSection);
+
+// writes the events buffered by the thread (i.e. the memory accesses), that must precede its next event in the log
+typedef void (*t_flush_pending)(const THREADID tid);
 
 class TraceLog 
 {
 public:
     TraceLog()
+        : m_shortLog(false), m_timeline(NULL), m_recorder(NULL), m_baseline(NULL), m_callerName(NULL), m_flushPending(NULL), m_isFlushing(false), m_profile(NULL), m_status(NULL)
     {
     }
 
@@ -26,17 +43,101 @@ public:
         createFile();
     }
 
-    void logCall(const ADDRINT prevModuleBase, const ADDRINT prevAddr, bool isRVA, const std::string module, const std::string func = "");
-    void logCall(const ADDRINT prevBase, const ADDRINT prevAddr, const ADDRINT calledPageBase, const ADDRINT callAddr);
-    void logSectionChange(const ADDRINT addr, std::string sectionName);
-    void logNewSectionCalled(const ADDRINT addFrom, std::string prevSection, std::string currSection);
+    // set the additional sink, to which the events are going to be written as a timeline
+    void setTimeline(TimelineLog* timeline)
+    {
+        m_timeline = timeline;
+    }
+
+    // keep the records in memory, and write them only on demand (see: dumpRecorder)
+    void setRecorder(FlightRecorder* recorder)
+    {
+        m_recorder = recorder;
+    }
+
+    // skip the events that were seen in the reference run (the section changes are always logged)
+    void setBaseline(EventBaseline* baseline, t_caller_name callerName)
+    {
+        m_baseline = baseline;
+        m_callerName = callerName;
+    }
+
+    // write the events buffered by the thread before any other event of this thread
+    void setPendingFlush(t_flush_pending flushPending)
+    {
+        m_flushPending = flushPending;
+    }
+
+    // count the written and the filtered events, and the time spent on writing
+    void setProfile(SelfProfile* profile)
+    {
+        m_profile = profile;
+    }
+
+    // expose the counts of the events in the status file
+    void setStatus(LiveStatus* status)
+    {
+        m_status = status;
+    }
+
+    // write the records kept by the flight recorder (if set)
+    void dumpRecorder(const std::string &reason);
+
+    const std::string& getFileName() const
+    {
+        return m_logFileName;
+    }
+
+    void logCall(const ADDRINT prevModuleBase, const ADDRINT prevAddr, bool isRVA, const std::string module, const std::string func = "", const int depth = DEPTH_UNKNOWN);
+    void logCall(const ADDRINT prevBase, const ADDRINT prevAddr, const ADDRINT calledPageBase, const ADDRINT callAddr, const int depth = DEPTH_UNKNOWN);
+    void logSectionChange(const ADDRINT base, const ADDRINT addr, std::string sectionName);
+    void logNewSectionCalled(const ADDRINT base, const ADDRINT addFrom, std::string prevSection, std::string currSection);
     void logRdtsc(const ADDRINT base, const ADDRINT rva);
     void logCpuid(const ADDRINT base, const ADDRINT rva, const ADDRINT param);
+    void logSyscall(const ADDRINT base, const ADDRINT rva, const ADDRINT number, const std::string &name, const ADDRINT* args, size_t argsCount, const ADDRINT* retVal);
+
+    void logTaintedBranch(const ADDRINT base, const ADDRINT rva, const std::string &source);
+    void logMemAccess(const ADDRINT base, const ADDRINT rva, const bool isWrite, const ADDRINT addr, const UINT32 size, const UINT32 count);
+
+    void logFunctionRet(const ADDRINT base, const ADDRINT rva, const std::string &func, const std::string &values);
+
+    // the arguments of the call logged just before, by the same thread
+    void logFunctionArgs(const std::string &args);
 
     void logLine(std::string str);
 
 protected:
 
+    // write the formatted line to the file, or pass it to the recorder
+    void commitLine();
+
+    /**
+        Commits the formatted event, unless it was seen in the reference run.
+        \param key : the identity of the event matched against the baseline; if empty: the text of the event, following the address
+    */
+    void commitEvent(const ADDRINT base, const ADDRINT rva, const std::string &key = "");
+
+    // commit the formatted arguments, unless the same call with the same arguments was seen in the reference run
+    // (if the call itself was skipped, it is written before its new arguments)
+    void commitArgs();
+
+    // drop the formatted line, filtered by the baseline
+    void skipLine();
+
+    // clear the line, along with the format flags set by the previous one (i.e. std::dec)
+    void resetLine()
+    {
+        m_line.str("");
+        m_line.flags(std::ios::dec | std::ios::skipws);
+    }
+
+    void logDepth(const int depth)
+    {
+        if (depth != DEPTH_UNKNOWN) {
+            m_line << " [depth=" << std::dec << depth << "]";
+        }
+    }
+
     bool createFile()
     {
         if (m_traceFile.is_open()) {
@@ -51,5 +152,15 @@ protected:
 
     std::string m_logFileName;
     std::ofstream m_traceFile;
+    std::stringstream m_line; // the line being formatted
     bool m_shortLog;
+    TimelineLog* m_timeline;
+    FlightRecorder* m_recorder;
+    EventBaseline* m_baseline;
+    t_caller_name m_callerName;
+    std::map<THREADID, std::string> m_skippedEvents; // the last event of the thread, if it was filtered by the baseline
+    t_flush_pending m_flushPending;
+    bool m_isFlushing; // the buffered events are being written
+    SelfProfile* m_profile;
+    LiveStatus* m_status;
 };
@@ -2,6 +2,19 @@
 
 #include <algorithm>
 
+#ifdef _MSC_VER
+extern "C" unsigned __int64 __rdtsc(void);
+#pragma intrinsic(__rdtsc)
+#endif
+
+namespace {
+    // std::tolower is overloaded (also in <locale>), so it cannot be passed to the algorithms directly
+    char toLowerChar(char c)
+    {
+        return static_cast<char>(::tolower(static_cast<unsigned char>(c)));
+    }
+};
+
 size_t util::getAsciiLen(const char *inp, size_t maxInp)
 {
     size_t i = 0;
@@ -32,7 +45,7 @@ std::string util::getDllName(const std::string& str)
     if (ext >= len) return "";
 
     std::string name = str.substr(found + 1, ext - (found + 1));
-    std::transform(name.begin(), name.end(), name.begin(), std::tolower);
+    std::transform(name.begin(), name.end(), name.begin(), toLowerChar);
     return name;
 }
 
@@ -46,3 +59,12 @@ bool util::iequals(const std::string& a, const std::string& b)
     }
     return true;
 }
+
+unsigned long long util::getTimestamp()
+{
+#ifdef _MSC_VER
+    return __rdtsc();
+#else
+    return __builtin_ia32_rdtsc();
+#endif
+}
@@ -19,4 +19,7 @@ namespace util {
     std::string getDllName(const std::string& str);
 
     bool iequals(const std::string& a, const std::string& b);
+
+    // read the Time Stamp Counter of the tool (not the value seen by the target)
+    unsigned long long getTimestamp();
 };
@@ -0,0 +1,258 @@
+/*
+    Microbenchmarks of the hot helpers of the tool, built standalone (without Pin), against the thin Pin stand-in (see: bench/pin_shim).
+    Covers also the adversarial inputs: long non-terminated strings, thousands of sections, big watch lists.
+    Usage: micro_bench [--quick] [name_filter]
+*/
+#include "pin.H"
+
+#include <chrono>
+#include <algorithm>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../../Util.h"
+#include "../../ParamStr.h"
+#include "../../ModuleInfo.h"
+#include "../../FuncWatch.h"
+#include "../../TraceLog.h"
+
+#define BENCH_REPS 5
+
+namespace {
+
+    volatile size_t g_sink = 0;
+
+    bool g_quick = false;
+
+    typedef size_t (*bench_func)(size_t iterations);
+
+    struct s_bench {
+        const char* name;
+        bench_func func;
+        size_t iterations; // in the quick mode: divided by 10
+        bool isFixed; // the iterations define the size of the input: not changed in the quick mode
+    };
+
+    // a buffer of printable characters, without any terminator, followed by a readable page
+    char* makeUnterminated(size_t size)
+    {
+        char* buf = static_cast<char*>(::mmap(NULL, size + 0x1000, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (buf == MAP_FAILED) {
+            std::cerr << "Allocation failed" << std::endl;
+            ::exit(1);
+        }
+        for (size_t i = 0; i < size + 0x1000; i++) {
+            buf[i] = 'A' + (i % 26);
+        }
+        return buf;
+    }
+
+    //---
+
+    size_t benchAsciiLenShort(size_t iterations)
+    {
+        const char* str = "C:\\Windows\\System32\\kernel32.dll";
+        size_t sum = 0;
+        for (size_t i = 0; i < iterations; i++) {
+            sum += util::getAsciiLen(str + (i & 3), 300);
+        }
+        return sum;
+    }
+
+    size_t benchAsciiLenUnterminated(size_t iterations)
+    {
+        static char* buf = makeUnterminated(0x100000);
+        size_t sum = 0;
+        for (size_t i = 0; i < iterations; i++) {
+            sum += util::getAsciiLen(buf + (i & 0xff), 300);
+        }
+        return sum;
+    }
+
+    size_t benchAsciiLenUnterminatedHuge(size_t iterations)
+    {
+        static char* buf = makeUnterminated(0x100000);
+        size_t sum = 0;
+        for (size_t i = 0; i < iterations; i++) {
+            sum += util::getAsciiLen(buf + (i & 0xff), 0x100000 - 0x100);
+        }
+        return sum;
+    }
+
+    size_t benchParamAscii(size_t iterations)
+    {
+        static char str[] = "C:\\Users\\user\\AppData\\Local\\Temp\\payload.bin";
+        size_t sum = 0;
+        for (size_t i = 0; i < iterations; i++) {
+            sum += paramToStr(str).length();
+        }
+        return sum;
+    }
+
+    size_t benchParamWide(size_t iterations)
+    {
+        static wchar_t str[] = L"C:\\Users\\user\\AppData\\Local\\Temp\\payload.bin";
+        size_t sum = 0;
+        for (size_t i = 0; i < iterations; i++) {
+            sum += paramToStr(str).length();
+        }
+        return sum;
+    }
+
+    size_t benchParamUnterminated(size_t iterations)
+    {
+        static char* buf = makeUnterminated(0x10000);
+        size_t sum = 0;
+        for (size_t i = 0; i < iterations; i++) {
+            sum += paramToStr(buf + (i & 0xff)).length();
+        }
+        return sum;
+    }
+
+    size_t benchParamValue(size_t iterations)
+    {
+        size_t sum = 0;
+        for (size_t i = 0; i < iterations; i++) {
+            // small values: not pointing to any mapped memory
+            sum += paramToStr(reinterpret_cast<VOID*>(0x10 + (i & 0xff))).length();
+        }
+        return sum;
+    }
+
+    //---
+
+    size_t benchSections(size_t iterations, size_t sectionsCount)
+    {
+        static std::map<size_t, std::map<ADDRINT, s_module> > cache;
+        std::map<ADDRINT, s_module> &sections = cache[sectionsCount];
+        if (sections.empty()) {
+            const ADDRINT kSecSize = 0x1000;
+            for (size_t i = 0; i < sectionsCount; i++) {
+                s_module sec;
+                std::stringstream ss;
+                ss << ".sec" << i;
+                sec.name = ss.str();
+                sec.start = (i + 1) * kSecSize;
+                sec.end = sec.start + kSecSize;
+                sec.is_valid = true;
+                sections[sec.start] = sec;
+            }
+        }
+        const ADDRINT maxAddr = (sectionsCount + 1) * 0x1000;
+        size_t sum = 0;
+        UINT64 rand = 0x9E3779B97F4A7C15ULL;
+        for (size_t i = 0; i < iterations; i++) {
+            rand ^= rand << 13; rand ^= rand >> 7; rand ^= rand << 17;
+            const s_module* sec = get_by_addr(ADDRINT(rand % maxAddr), sections);
+            sum += sec ? sec->start : 0;
+        }
+        return sum;
+    }
+
+    size_t benchSections16(size_t iterations) { return benchSections(iterations, 16); }
+    size_t benchSections1k(size_t iterations) { return benchSections(iterations, 1000); }
+    size_t benchSections5k(size_t iterations) { return benchSections(iterations, 5000); }
+
+    //---
+
+    // iterations: the number of the entries in the watch list
+    size_t benchWatchList(size_t iterations)
+    {
+        const std::string fileName = "/tmp/tt_micro_watch.txt";
+        {
+            std::ofstream out(fileName.c_str());
+            for (size_t i = 0; i < iterations; i++) {
+                out << "dll" << (i % 64) << ";Function" << i << ";" << (i % 10) << ((i % 7) ? "" : ";r,o1:*3") << "\n";
+            }
+        }
+        FuncWatchList list;
+        const size_t count = list.loadList(fileName.c_str());
+        ::unlink(fileName.c_str());
+        return count;
+    }
+
+    //---
+
+    size_t benchLogCall(size_t iterations, bool isShort)
+    {
+        const std::string fileName = "/tmp/tt_micro_log.tag";
+        size_t sum = 0;
+        {
+            TraceLog log;
+            log.init(fileName, isShort);
+            const std::string module = "C:\\Windows\\System32\\kernel32.dll";
+            const std::string func = "CreateFileW";
+            for (size_t i = 0; i < iterations; i++) {
+                log.logCall(0x400000, 0x401000 + (i & 0xfff), false, module, func);
+            }
+            sum = iterations;
+        }
+        ::unlink(fileName.c_str());
+        return sum;
+    }
+
+    size_t benchLogCallShort(size_t iterations) { return benchLogCall(iterations, true); }
+    size_t benchLogCallLong(size_t iterations) { return benchLogCall(iterations, false); }
+
+    //---
+
+    const s_bench g_benches[] = {
+        { "ascii_len/short", benchAsciiLenShort, 1000000, false },
+        { "ascii_len/unterminated", benchAsciiLenUnterminated, 100000, false },
+        { "ascii_len/unterminated_1mb", benchAsciiLenUnterminatedHuge, 100, false },
+        { "param_to_str/ascii", benchParamAscii, 100000, false },
+        { "param_to_str/wide", benchParamWide, 100000, false },
+        { "param_to_str/unterminated", benchParamUnterminated, 100000, false },
+        { "param_to_str/value", benchParamValue, 100000, false },
+        { "get_by_addr/16_sections", benchSections16, 1000000, false },
+        { "get_by_addr/1k_sections", benchSections1k, 100000, false },
+        { "get_by_addr/5k_sections", benchSections5k, 20000, false },
+        { "watch_list/load_5k", benchWatchList, 5000, true },
+        { "watch_list/load_50k", benchWatchList, 50000, true },
+        { "trace_log/log_call_short", benchLogCallShort, 100000, false },
+        { "trace_log/log_call", benchLogCallLong, 100000, false },
+    };
+
+    void runBench(const s_bench &bench)
+    {
+        size_t iterations = bench.iterations;
+        if (g_quick && !bench.isFixed) {
+            iterations = std::max<size_t>(1, iterations / 10);
+        }
+        // the inputs of a fixed size are big enough to be measured once
+        const size_t reps = bench.isFixed ? 1 : BENCH_REPS;
+        std::vector<double> times;
+        for (size_t rep = 0; rep < reps; rep++) {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            g_sink += bench.func(iterations);
+            const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        const double median = times[times.size() / 2];
+        std::printf("%-32s %10zu iter %14.1f ns/iter (min: %.1f) %12.3f ms total\n",
+            bench.name, iterations, median / iterations, times[0] / iterations, median / 1e6);
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    std::string filter;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--quick") {
+            g_quick = true;
+        }
+        else {
+            filter = arg;
+        }
+    }
+    const size_t count = sizeof(g_benches) / sizeof(g_benches[0]);
+    for (size_t i = 0; i < count; i++) {
+        if (!filter.empty() && std::string(g_benches[i].name).find(filter) == std::string::npos) {
+            continue;
+        }
+        runBench(g_benches[i]);
+    }
+    return 0;
+}
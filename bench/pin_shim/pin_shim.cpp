@@ -0,0 +1,661 @@
+#include "pin.H"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define SHIM_PAGE_SIZE 0x1000
+
+struct SHIM_RTN_ {
+    std::string name;
+    ADDRINT address;
+    USIZE size;
+    UINT32 id;
+    SEC sec;
+    RTN next;
+};
+
+struct SHIM_SEC_ {
+    std::string name;
+    ADDRINT address;
+    USIZE size;
+    IMG img;
+    SEC next;
+    RTN rtnHead;
+    RTN rtnTail;
+};
+
+struct SHIM_IMG_ {
+    std::string name;
+    ADDRINT low;
+    ADDRINT high;
+    ADDRINT loadOffset;
+    bool isMain;
+    UINT32 id;
+    std::vector<SEC> sections;
+    std::vector<RTN> routines; // sorted by the address
+};
+
+namespace {
+    pthread_mutex_t g_clientLock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_t g_shimLock = PTHREAD_MUTEX_INITIALIZER;
+    const std::string g_emptyName;
+
+    struct s_img_callback { IMAGECALLBACK fun; VOID* v; };
+    struct s_thread_start_callback { THREAD_START_CALLBACK fun; VOID* v; };
+    struct s_thread_fini_callback { THREAD_FINI_CALLBACK fun; VOID* v; };
+    struct s_fini_callback { FINI_CALLBACK fun; VOID* v; };
+
+    std::vector<s_img_callback> g_imgLoadCallbacks;
+    std::vector<s_img_callback> g_imgUnloadCallbacks;
+    std::vector<s_thread_start_callback> g_threadStartCallbacks;
+    std::vector<s_thread_fini_callback> g_threadFiniCallbacks;
+    std::vector<s_fini_callback> g_finiCallbacks;
+    std::vector<s_fini_callback> g_prepareFiniCallbacks;
+
+    std::map<ADDRINT, IMG> g_images; // by the lowest address
+    UINT32 g_nextImgId = 1;
+    UINT32 g_nextRtnId = 1;
+
+    std::set<THREADID> g_liveThreads;
+    __thread bool t_hasThreadId = false;
+    __thread THREADID t_threadId = 0;
+
+    std::vector<DESTRUCTFUN> g_tlsKeys;
+    std::map<std::pair<TLS_KEY, THREADID>, const VOID*> g_tlsData;
+
+    bool g_useRegions = false;
+    std::map<ADDRINT, USIZE> g_regions; // readable: by the start
+
+    VOID (*g_program)() = NULL;
+    bool g_isExiting = false;
+
+    bool lessRtnAddr(const RTN a, const RTN b)
+    {
+        return a->address < b->address;
+    }
+
+    bool isInRegion(ADDRINT addr)
+    {
+        std::map<ADDRINT, USIZE>::const_iterator itr = g_regions.upper_bound(addr);
+        if (itr == g_regions.begin()) return false;
+        --itr;
+        return addr < itr->first + itr->second;
+    }
+
+    // \return : the number of the readable bytes, starting at the address, up to the given size
+    size_t readableSize(ADDRINT addr, size_t size)
+    {
+        size_t readable = 0;
+        while (readable < size) {
+            const ADDRINT curr = addr + readable;
+            if (!isInRegion(curr)) break;
+            std::map<ADDRINT, USIZE>::const_iterator itr = --g_regions.upper_bound(curr);
+            readable = (itr->first + itr->second) - addr;
+        }
+        return std::min(readable, size);
+    }
+};
+
+//---
+// Command line switches
+
+KNOB_BASE::KNOB_BASE(KNOB_MODE mode, const std::string &family, const std::string &name, const std::string &defaultValue, const std::string &desc)
+    : m_mode(mode), m_name(name), m_desc(desc), m_isSet(false)
+{
+    if (defaultValue.length() || mode != KNOB_MODE_APPEND) {
+        m_values.push_back(defaultValue);
+    }
+    registry().push_back(this);
+}
+
+std::vector<KNOB_BASE*>& KNOB_BASE::registry()
+{
+    static std::vector<KNOB_BASE*> knobs;
+    return knobs;
+}
+
+std::string KNOB_BASE::StringKnobSummary()
+{
+    std::stringstream ss;
+    const std::vector<KNOB_BASE*> &knobs = registry();
+    for (size_t i = 0; i < knobs.size(); i++) {
+        ss << "-" << knobs[i]->m_name << "  [default " << (knobs[i]->m_values.size() ? knobs[i]->m_values[0] : "") << "]\n";
+        ss << "\t" << knobs[i]->m_desc << "\n";
+    }
+    return ss.str();
+}
+
+bool KNOB_BASE::parse(int argc, char *argv[])
+{
+    const std::vector<KNOB_BASE*> &knobs = registry();
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--") break;
+        if (arg == "-t") { // the tool itself
+            i++;
+            continue;
+        }
+        if (arg.length() < 2 || arg[0] != '-') return false;
+
+        KNOB_BASE* knob = NULL;
+        for (size_t k = 0; k < knobs.size(); k++) {
+            if (knobs[k]->m_name == arg.substr(1)) {
+                knob = knobs[k];
+                break;
+            }
+        }
+        if (!knob) return false;
+
+        std::string value = "1";
+        if (!knob->isFlag() || (i + 1 < argc && (std::string(argv[i + 1]) == "0" || std::string(argv[i + 1]) == "1"))) {
+            if (i + 1 >= argc) return false;
+            value = argv[++i];
+        }
+        if (knob->m_mode == KNOB_MODE_APPEND) {
+            if (!knob->m_isSet) knob->m_values.clear();
+            knob->m_values.push_back(value);
+        }
+        else {
+            knob->m_values.assign(1, value);
+        }
+        knob->m_isSet = true;
+    }
+    return true;
+}
+
+//---
+// Callbacks
+
+VOID IMG_AddInstrumentFunction(IMAGECALLBACK fun, VOID* v)
+{
+    s_img_callback cb = { fun, v };
+    g_imgLoadCallbacks.push_back(cb);
+}
+
+VOID IMG_AddUnloadFunction(IMAGECALLBACK fun, VOID* v)
+{
+    s_img_callback cb = { fun, v };
+    g_imgUnloadCallbacks.push_back(cb);
+}
+
+VOID PIN_AddThreadStartFunction(THREAD_START_CALLBACK fun, VOID* v)
+{
+    s_thread_start_callback cb = { fun, v };
+    g_threadStartCallbacks.push_back(cb);
+}
+
+VOID PIN_AddThreadFiniFunction(THREAD_FINI_CALLBACK fun, VOID* v)
+{
+    s_thread_fini_callback cb = { fun, v };
+    g_threadFiniCallbacks.push_back(cb);
+}
+
+VOID PIN_AddFiniFunction(FINI_CALLBACK fun, VOID* v)
+{
+    s_fini_callback cb = { fun, v };
+    g_finiCallbacks.push_back(cb);
+}
+
+VOID PIN_AddPrepareForFiniFunction(FINI_CALLBACK fun, VOID* v)
+{
+    s_fini_callback cb = { fun, v };
+    g_prepareFiniCallbacks.push_back(cb);
+}
+
+//---
+// Process, threads, locks
+
+BOOL PIN_Init(INT32 argc, CHAR** argv)
+{
+    // as in Pin: true on error
+    return !KNOB_BASE::parse(argc, argv);
+}
+
+VOID PIN_StartProgram()
+{
+    if (g_program) {
+        g_program();
+    }
+    for (size_t i = 0; i < g_prepareFiniCallbacks.size(); i++) {
+        g_prepareFiniCallbacks[i].fun(0, g_prepareFiniCallbacks[i].v);
+    }
+    g_isExiting = true;
+    // the threads that did not exit on their own
+    const std::set<THREADID> threads = g_liveThreads;
+    for (std::set<THREADID>::const_iterator itr = threads.begin(); itr != threads.end(); ++itr) {
+        shim::finiThread(*itr);
+    }
+    for (size_t i = 0; i < g_finiCallbacks.size(); i++) {
+        g_finiCallbacks[i].fun(0, g_finiCallbacks[i].v);
+    }
+}
+
+BOOL PIN_IsProcessExiting()
+{
+    return g_isExiting;
+}
+
+VOID PIN_InitLock(PIN_LOCK* lock)
+{
+    pthread_mutex_init(&lock->mutex, NULL);
+}
+
+VOID PIN_GetLock(PIN_LOCK* lock, INT32 val)
+{
+    pthread_mutex_lock(&lock->mutex);
+}
+
+VOID PIN_ReleaseLock(PIN_LOCK* lock)
+{
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+VOID PIN_LockClient()
+{
+    pthread_mutex_lock(&g_clientLock);
+}
+
+VOID PIN_UnlockClient()
+{
+    pthread_mutex_unlock(&g_clientLock);
+}
+
+THREADID PIN_ThreadId()
+{
+    if (t_hasThreadId) {
+        return t_threadId;
+    }
+    // Pin numbers the threads from 0, in the order of their creation: by default only the uniqueness matters
+    return static_cast<THREADID>(::syscall(SYS_gettid) - ::getpid());
+}
+
+UINT64 PIN_ThreadUid()
+{
+    return PIN_ThreadId();
+}
+
+INT PIN_GetPid()
+{
+    return ::getpid();
+}
+
+VOID PIN_Sleep(UINT32 milliseconds)
+{
+    ::usleep(milliseconds * 1000);
+}
+
+TLS_KEY PIN_CreateThreadDataKey(DESTRUCTFUN destructor)
+{
+    pthread_mutex_lock(&g_shimLock);
+    g_tlsKeys.push_back(destructor);
+    const TLS_KEY key = (TLS_KEY)(g_tlsKeys.size() - 1);
+    pthread_mutex_unlock(&g_shimLock);
+    return key;
+}
+
+BOOL PIN_SetThreadData(TLS_KEY key, const VOID* data, THREADID tid)
+{
+    pthread_mutex_lock(&g_shimLock);
+    g_tlsData[std::make_pair(key, tid)] = data;
+    pthread_mutex_unlock(&g_shimLock);
+    return true;
+}
+
+VOID* PIN_GetThreadData(TLS_KEY key, THREADID tid)
+{
+    VOID* data = NULL;
+    pthread_mutex_lock(&g_shimLock);
+    std::map<std::pair<TLS_KEY, THREADID>, const VOID*>::const_iterator itr = g_tlsData.find(std::make_pair(key, tid));
+    if (itr != g_tlsData.end()) {
+        data = const_cast<VOID*>(itr->second);
+    }
+    pthread_mutex_unlock(&g_shimLock);
+    return data;
+}
+
+namespace {
+    struct s_internal_thread {
+        ROOT_THREAD_FUNC fun;
+        VOID* arg;
+    };
+
+    void* internalThreadMain(void* param)
+    {
+        s_internal_thread* thread = static_cast<s_internal_thread*>(param);
+        thread->fun(thread->arg);
+        delete thread;
+        return NULL;
+    }
+
+    std::map<PIN_THREAD_UID, pthread_t> g_internalThreads;
+};
+
+THREADID PIN_SpawnInternalThread(ROOT_THREAD_FUNC fun, VOID* arg, USIZE stackSize, PIN_THREAD_UID* uid)
+{
+    s_internal_thread* thread = new s_internal_thread();
+    thread->fun = fun;
+    thread->arg = arg;
+    pthread_t handle;
+    if (pthread_create(&handle, NULL, internalThreadMain, thread) != 0) {
+        delete thread;
+        return INVALID_THREADID;
+    }
+    pthread_mutex_lock(&g_shimLock);
+    const PIN_THREAD_UID threadUid = (PIN_THREAD_UID)g_internalThreads.size() + 1;
+    g_internalThreads[threadUid] = handle;
+    pthread_mutex_unlock(&g_shimLock);
+    if (uid) *uid = threadUid;
+    return (THREADID)(0x10000 + threadUid);
+}
+
+BOOL PIN_WaitForThreadTermination(const PIN_THREAD_UID &uid, UINT32 milliseconds, INT32* exitCode)
+{
+    pthread_mutex_lock(&g_shimLock);
+    std::map<PIN_THREAD_UID, pthread_t>::iterator itr = g_internalThreads.find(uid);
+    if (itr == g_internalThreads.end()) {
+        pthread_mutex_unlock(&g_shimLock);
+        return false;
+    }
+    const pthread_t handle = itr->second;
+    g_internalThreads.erase(itr);
+    pthread_mutex_unlock(&g_shimLock);
+    pthread_join(handle, NULL);
+    if (exitCode) *exitCode = 0;
+    return true;
+}
+
+VOID PIN_ExitThread(INT32 code)
+{
+    pthread_exit(NULL);
+}
+
+//---
+// Memory
+
+BOOL PIN_CheckReadAccess(VOID* addr)
+{
+    if (g_useRegions) {
+        return isInRegion(reinterpret_cast<ADDRINT>(addr));
+    }
+    // the page is readable if it is mapped: mincore fails on the unmapped pages
+    unsigned char vec = 0;
+    void* page = reinterpret_cast<void*>(GetPageOfAddr(reinterpret_cast<ADDRINT>(addr)));
+    return ::mincore(page, SHIM_PAGE_SIZE, &vec) == 0;
+}
+
+BOOL PIN_CheckWriteAccess(VOID* addr)
+{
+    return PIN_CheckReadAccess(addr);
+}
+
+size_t PIN_SafeCopy(VOID* dst, const VOID* src, size_t size)
+{
+    if (g_useRegions) {
+        size = readableSize(reinterpret_cast<ADDRINT>(src), size);
+    }
+    ::memcpy(dst, src, size);
+    return size;
+}
+
+ADDRINT GetPageOfAddr(ADDRINT addr)
+{
+    return addr & ~ADDRINT(SHIM_PAGE_SIZE - 1);
+}
+
+//---
+// OS APIs
+
+namespace {
+    OS_RETURN_CODE makeReturnCode(OS_RETURN_CODE_GENERIC err)
+    {
+        OS_RETURN_CODE ret = { err, (UINT32)((err == OS_RETURN_CODE_NO_ERROR) ? 0 : errno) };
+        return ret;
+    }
+};
+
+OS_RETURN_CODE OS_OpenFD(const CHAR* path, INT flags, UINT32 mode, NATIVE_FD* fd)
+{
+    int osFlags = 0;
+    if ((flags & OS_FILE_OPEN_TYPE_READ) && (flags & OS_FILE_OPEN_TYPE_WRITE)) osFlags |= O_RDWR;
+    else if (flags & OS_FILE_OPEN_TYPE_WRITE) osFlags |= O_WRONLY;
+    if (flags & OS_FILE_OPEN_TYPE_CREATE) osFlags |= O_CREAT;
+    if (flags & OS_FILE_OPEN_TYPE_TRUNCATE) osFlags |= O_TRUNC;
+    if (flags & OS_FILE_OPEN_TYPE_APPEND) osFlags |= O_APPEND;
+    int osMode = 0;
+    if (mode & OS_FILE_PERMISSION_TYPE_READ) osMode |= 0444;
+    if (mode & OS_FILE_PERMISSION_TYPE_WRITE) osMode |= 0200;
+
+    *fd = ::open(path, osFlags, osMode);
+    return makeReturnCode((*fd < 0) ? OS_RETURN_CODE_FILE_OPEN_FAILED : OS_RETURN_CODE_NO_ERROR);
+}
+
+OS_RETURN_CODE OS_WriteFD(NATIVE_FD fd, const VOID* buffer, USIZE* count)
+{
+    const ssize_t written = ::write(fd, buffer, *count);
+    *count = (written < 0) ? 0 : written;
+    return makeReturnCode((written < 0) ? OS_RETURN_CODE_FILE_WRITE_FAILED : OS_RETURN_CODE_NO_ERROR);
+}
+
+OS_RETURN_CODE OS_CloseFD(NATIVE_FD fd)
+{
+    ::close(fd);
+    return makeReturnCode(OS_RETURN_CODE_NO_ERROR);
+}
+
+OS_RETURN_CODE OS_MapFileToMemory(NATIVE_PID pid, UINT32 protectionFlags, USIZE size, OS_MEMORY_FLAGS flags, NATIVE_FD fd, UINT64 offset, VOID** base)
+{
+    int prot = 0;
+    if (protectionFlags & OS_PAGE_PROTECTION_TYPE_READ) prot |= PROT_READ;
+    if (protectionFlags & OS_PAGE_PROTECTION_TYPE_WRITE) prot |= PROT_WRITE;
+    if (protectionFlags & OS_PAGE_PROTECTION_TYPE_EXECUTE) prot |= PROT_EXEC;
+
+    void* mapped = ::mmap(*base, size, prot, (flags == OS_MEMORY_FLAGS_SHARED) ? MAP_SHARED : MAP_PRIVATE, fd, offset);
+    if (mapped == MAP_FAILED) {
+        return makeReturnCode(OS_RETURN_CODE_MEMORY_MAP_FAILED);
+    }
+    *base = mapped;
+    return makeReturnCode(OS_RETURN_CODE_NO_ERROR);
+}
+
+OS_RETURN_CODE OS_FreeMemory(NATIVE_PID pid, VOID* base, USIZE size)
+{
+    ::munmap(base, size);
+    return makeReturnCode(OS_RETURN_CODE_NO_ERROR);
+}
+
+//---
+// Images, sections, routines
+
+IMG IMG_FindByAddress(ADDRINT addr)
+{
+    std::map<ADDRINT, IMG>::const_iterator itr = g_images.upper_bound(addr);
+    if (itr == g_images.begin()) return NULL;
+    --itr;
+    IMG img = itr->second;
+    return (addr <= img->high) ? img : NULL;
+}
+
+BOOL IMG_Valid(IMG img) { return img != NULL; }
+const std::string& IMG_Name(IMG img) { return img ? img->name : g_emptyName; }
+ADDRINT IMG_LoadOffset(IMG img) { return img ? img->loadOffset : 0; }
+ADDRINT IMG_LowAddress(IMG img) { return img ? img->low : 0; }
+ADDRINT IMG_HighAddress(IMG img) { return img ? img->high : 0; }
+USIZE IMG_SizeMapped(IMG img) { return img ? (img->high - img->low + 1) : 0; }
+UINT32 IMG_Id(IMG img) { return img ? img->id : 0; }
+BOOL IMG_IsMainExecutable(IMG img) { return img ? img->isMain : false; }
+SEC IMG_SecHead(IMG img) { return (img && img->sections.size()) ? img->sections[0] : NULL; }
+
+BOOL SEC_Valid(SEC sec) { return sec != NULL; }
+SEC SEC_Next(SEC sec) { return sec ? sec->next : NULL; }
+const std::string& SEC_Name(SEC sec) { return sec ? sec->name : g_emptyName; }
+ADDRINT SEC_Address(SEC sec) { return sec ? sec->address : 0; }
+USIZE SEC_Size(SEC sec) { return sec ? sec->size : 0; }
+IMG SEC_Img(SEC sec) { return sec ? sec->img : NULL; }
+RTN SEC_RtnHead(SEC sec) { return sec ? sec->rtnHead : NULL; }
+
+RTN RTN_FindByAddress(ADDRINT addr)
+{
+    IMG img = IMG_FindByAddress(addr);
+    if (!img || img->routines.empty()) return NULL;
+
+    SHIM_RTN_ key;
+    key.address = addr;
+    std::vector<RTN>::const_iterator itr = std::upper_bound(img->routines.begin(), img->routines.end(), &key, lessRtnAddr);
+    if (itr == img->routines.begin()) return NULL;
+    --itr;
+    RTN rtn = *itr;
+    return (addr < rtn->address + std::max<USIZE>(rtn->size, 1)) ? rtn : NULL;
+}
+
+RTN RTN_FindByName(IMG img, const CHAR* name)
+{
+    if (!img || !name) return NULL;
+    for (size_t i = 0; i < img->routines.size(); i++) {
+        if (img->routines[i]->name == name) return img->routines[i];
+    }
+    return NULL;
+}
+
+BOOL RTN_Valid(RTN rtn) { return rtn != NULL; }
+RTN RTN_Next(RTN rtn) { return rtn ? rtn->next : NULL; }
+const std::string& RTN_Name(RTN rtn) { return rtn ? rtn->name : g_emptyName; }
+ADDRINT RTN_Address(RTN rtn) { return rtn ? rtn->address : 0; }
+USIZE RTN_Size(RTN rtn) { return rtn ? rtn->size : 0; }
+SEC RTN_Sec(RTN rtn) { return rtn ? rtn->sec : NULL; }
+UINT32 RTN_Id(RTN rtn) { return rtn ? rtn->id : 0; }
+
+//---
+// The interface of the shim
+
+IMG shim::addImage(const std::string &name, ADDRINT low, ADDRINT high, ADDRINT loadOffset, bool isMain)
+{
+    IMG img = new SHIM_IMG_();
+    img->name = name;
+    img->low = low;
+    img->high = high;
+    img->loadOffset = loadOffset;
+    img->isMain = isMain;
+    img->id = g_nextImgId++;
+    g_images[low] = img;
+    return img;
+}
+
+SEC shim::addSection(IMG img, const std::string &name, ADDRINT address, USIZE size)
+{
+    SEC sec = new SHIM_SEC_();
+    sec->name = name;
+    sec->address = address;
+    sec->size = size;
+    sec->img = img;
+    sec->next = NULL;
+    sec->rtnHead = sec->rtnTail = NULL;
+    if (img->sections.size()) {
+        img->sections.back()->next = sec;
+    }
+    img->sections.push_back(sec);
+    return sec;
+}
+
+RTN shim::addRoutine(IMG img, const std::string &name, ADDRINT address, USIZE size)
+{
+    RTN rtn = new SHIM_RTN_();
+    rtn->name = name;
+    rtn->address = address;
+    rtn->size = size;
+    rtn->id = g_nextRtnId++;
+    rtn->sec = NULL;
+    rtn->next = NULL;
+    for (size_t i = 0; i < img->sections.size(); i++) {
+        SEC sec = img->sections[i];
+        if (address >= sec->address && address < sec->address + sec->size) {
+            rtn->sec = sec;
+            if (sec->rtnTail) sec->rtnTail->next = rtn;
+            else sec->rtnHead = rtn;
+            sec->rtnTail = rtn;
+            break;
+        }
+    }
+    std::vector<RTN>::iterator itr = std::upper_bound(img->routines.begin(), img->routines.end(), rtn, lessRtnAddr);
+    img->routines.insert(itr, rtn);
+    return rtn;
+}
+
+IMG shim::findImageByLow(ADDRINT low)
+{
+    std::map<ADDRINT, IMG>::const_iterator itr = g_images.find(low);
+    return (itr != g_images.end()) ? itr->second : NULL;
+}
+
+VOID shim::loadImage(IMG img)
+{
+    for (size_t i = 0; i < g_imgLoadCallbacks.size(); i++) {
+        g_imgLoadCallbacks[i].fun(img, g_imgLoadCallbacks[i].v);
+    }
+}
+
+VOID shim::unloadImage(IMG img)
+{
+    for (size_t i = 0; i < g_imgUnloadCallbacks.size(); i++) {
+        g_imgUnloadCallbacks[i].fun(img, g_imgUnloadCallbacks[i].v);
+    }
+    g_images.erase(img->low);
+    for (size_t i = 0; i < img->routines.size(); i++) {
+        delete img->routines[i];
+    }
+    for (size_t i = 0; i < img->sections.size(); i++) {
+        delete img->sections[i];
+    }
+    delete img;
+}
+
+VOID shim::setThreadId(THREADID tid)
+{
+    t_hasThreadId = true;
+    t_threadId = tid;
+}
+
+VOID shim::startThread(THREADID tid)
+{
+    setThreadId(tid);
+    g_liveThreads.insert(tid);
+    CONTEXT ctxt = { { 0 } };
+    for (size_t i = 0; i < g_threadStartCallbacks.size(); i++) {
+        g_threadStartCallbacks[i].fun(tid, &ctxt, 0, g_threadStartCallbacks[i].v);
+    }
+}
+
+VOID shim::finiThread(THREADID tid)
+{
+    setThreadId(tid);
+    CONTEXT ctxt = { { 0 } };
+    for (size_t i = 0; i < g_threadFiniCallbacks.size(); i++) {
+        g_threadFiniCallbacks[i].fun(tid, &ctxt, 0, g_threadFiniCallbacks[i].v);
+    }
+    g_liveThreads.erase(tid);
+}
+
+VOID shim::useReadableRegions(bool isEnabled)
+{
+    g_useRegions = isEnabled;
+}
+
+VOID shim::clearReadableRegions()
+{
+    g_regions.clear();
+}
+
+VOID shim::addReadableRegion(ADDRINT start, USIZE size)
+{
+    if (!size) return;
+    USIZE &curr = g_regions[start];
+    curr = std::max(curr, size);
+}
+
+VOID shim::setProgram(VOID (*program)())
+{
+    g_program = program;
+}
@@ -0,0 +1,299 @@
+/*
+    Replays the recording made by the tool (-record <file>) without Pin: the recorded inputs are fed back through the same
+    analysis routines, with the images, threads and memory simulated by the Pin stand-in (see: bench/pin_shim).
+    Gives a deterministic workload, to be profiled with the regular tools (perf, valgrind), and to check if a change to the
+    tool alters its output.
+    Usage: replay <recording> [-o <output>] [--compare <expected output>] [-- <tool options overriding the recorded ones>]
+*/
+#include "pin.H"
+
+#include <chrono>
+#include <algorithm>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../../ReplayRecord.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+#define REPLAY_PAGE_SIZE 0x1000
+
+// the entry points of the tool (see: TinyTracer.cpp, built with main renamed)
+int TinyTracer_main(int argc, char *argv[]);
+VOID SaveTransitions(const ADDRINT prevVA, const ADDRINT Address);
+VOID RdtscCalled(const CONTEXT* ctxt);
+VOID CpuidCalled(const CONTEXT* ctxt);
+VOID LogFunctionArgs(const THREADID tid, const UINT32 funcId, const ADDRINT stackPtr, const ADDRINT Address, CHAR *name, uint32_t argCount, VOID *arg1, VOID *arg2, VOID *arg3, VOID *arg4, VOID *arg5, VOID *arg6, VOID *arg7, VOID *arg8, VOID *arg9, VOID *arg10);
+
+namespace {
+
+    const char* g_typeNames[REC_TYPES_COUNT] = {
+        "none", "image_load", "image_unload", "thread_start", "thread_fini", "transition", "rdtsc", "cpuid", "func_args"
+    };
+
+    std::vector<s_record> g_records;
+    std::set<ADDRINT> g_mappedPages;
+    size_t g_mapFailures = 0;
+    size_t g_typeCounts[REC_TYPES_COUNT] = { 0 };
+    double g_replayNs = 0;
+
+    bool isMapped(ADDRINT start, size_t size)
+    {
+        for (ADDRINT page = GetPageOfAddr(start); page < start + size; page += REPLAY_PAGE_SIZE) {
+            if (g_mappedPages.find(page) == g_mappedPages.end()) return false;
+        }
+        return true;
+    }
+
+    // map the pages at which the arguments pointed, at their original addresses, so that the pointers stay valid
+    void mapSnapshotPages()
+    {
+        std::set<ADDRINT> pages;
+        for (size_t i = 0; i < g_records.size(); i++) {
+            const s_record &rec = g_records[i];
+            if (rec.type != REC_FUNC_ARGS) continue;
+            for (size_t k = 0; k < rec.args.size(); k++) {
+                const ADDRINT start = (ADDRINT)rec.args[k].value;
+                const size_t size = rec.args[k].snapshot.size();
+                if (!size) continue;
+                for (ADDRINT page = GetPageOfAddr(start); page < start + size; page += REPLAY_PAGE_SIZE) {
+                    pages.insert(page);
+                }
+            }
+        }
+        for (std::set<ADDRINT>::const_iterator itr = pages.begin(); itr != pages.end(); ++itr) {
+            void* wanted = reinterpret_cast<void*>(*itr);
+            void* mapped = ::mmap(wanted, REPLAY_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+            if (mapped == wanted) {
+                g_mappedPages.insert(*itr);
+                continue;
+            }
+            // taken by the replay itself: the arguments pointing there are treated as unreadable
+            if (mapped != MAP_FAILED) {
+                ::munmap(mapped, REPLAY_PAGE_SIZE);
+            }
+            g_mapFailures++;
+        }
+    }
+
+    void replayImageLoad(const s_record &rec)
+    {
+        const s_rec_image &info = rec.image;
+        IMG img = shim::addImage(info.name, (ADDRINT)info.low, (ADDRINT)info.high, (ADDRINT)info.loadOffset, info.isMain);
+        for (size_t i = 0; i < info.sections.size(); i++) {
+            shim::addSection(img, info.sections[i].name, (ADDRINT)info.sections[i].start, (USIZE)info.sections[i].size);
+        }
+        for (size_t i = 0; i < info.routines.size(); i++) {
+            shim::addRoutine(img, info.routines[i].name, (ADDRINT)info.routines[i].start, (USIZE)info.routines[i].size);
+        }
+        shim::loadImage(img);
+    }
+
+    void replayFuncArgs(const s_record &rec)
+    {
+        VOID* args[10] = { NULL };
+        shim::clearReadableRegions();
+        for (size_t i = 0; i < rec.args.size() && i < 10; i++) {
+            const s_rec_arg &arg = rec.args[i];
+            args[i] = reinterpret_cast<VOID*>((ADDRINT)arg.value);
+            const size_t size = arg.snapshot.size();
+            if (size && isMapped((ADDRINT)arg.value, size)) {
+                ::memcpy(args[i], arg.snapshot.data(), size);
+                shim::addReadableRegion((ADDRINT)arg.value, size);
+            }
+        }
+        CHAR* name = const_cast<CHAR*>(rec.name.c_str());
+        LogFunctionArgs(rec.tid, rec.funcId, (ADDRINT)rec.values[0], (ADDRINT)rec.values[1], name, (uint32_t)rec.args.size(),
+            args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7], args[8], args[9]);
+    }
+
+    void replayRecord(const s_record &rec)
+    {
+        CONTEXT ctxt = { { 0 } };
+        shim::setThreadId(rec.tid);
+        switch (rec.type) {
+        case REC_IMAGE_LOAD:
+            replayImageLoad(rec);
+            break;
+        case REC_IMAGE_UNLOAD:
+        {
+            IMG img = shim::findImageByLow((ADDRINT)rec.values[0]);
+            if (img) shim::unloadImage(img);
+            break;
+        }
+        case REC_THREAD_START:
+            shim::startThread(rec.tid);
+            break;
+        case REC_THREAD_FINI:
+            shim::finiThread(rec.tid);
+            break;
+        case REC_TRANSITION:
+            SaveTransitions((ADDRINT)rec.values[0], (ADDRINT)rec.values[1]);
+            break;
+        case REC_RDTSC:
+            ctxt.regs[REG_INST_PTR] = (ADDRINT)rec.values[0];
+            RdtscCalled(&ctxt);
+            break;
+        case REC_CPUID:
+            ctxt.regs[REG_INST_PTR] = (ADDRINT)rec.values[0];
+            ctxt.regs[REG_GAX] = (ADDRINT)rec.values[1];
+            CpuidCalled(&ctxt);
+            break;
+        case REC_FUNC_ARGS:
+            replayFuncArgs(rec);
+            break;
+        }
+    }
+
+    // executed by the Pin stand-in, in place of the application
+    VOID replayProgram()
+    {
+        shim::useReadableRegions(true);
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < g_records.size(); i++) {
+            replayRecord(g_records[i]);
+        }
+        const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        g_replayNs = std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    bool hasOption(const std::vector<std::string> &args, const std::string &name)
+    {
+        return std::find(args.begin(), args.end(), name) != args.end();
+    }
+
+    // the value of the last occurrence of the option, or the default
+    std::string getOption(const std::vector<std::string> &args, const std::string &name, const std::string &defaultVal)
+    {
+        std::string val = defaultVal;
+        for (size_t i = 0; i + 1 < args.size(); i++) {
+            if (args[i] == name) val = args[i + 1];
+        }
+        return val;
+    }
+
+    bool readFile(const std::string &fileName, std::string &content)
+    {
+        std::ifstream file(fileName.c_str(), std::ios::binary);
+        if (!file.is_open()) return false;
+        std::stringstream ss;
+        ss << file.rdbuf();
+        content = ss.str();
+        return true;
+    }
+
+    int usage()
+    {
+        std::cerr << "Usage: replay <recording> [-o <output>] [--compare <expected output>] [-- <tool options>]" << std::endl;
+        return 1;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    std::string recordFile;
+    std::string outFile;
+    std::string compareFile;
+    std::vector<std::string> overrides;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--") {
+            for (i++; i < argc; i++) overrides.push_back(argv[i]);
+            break;
+        }
+        if (arg == "-o" && i + 1 < argc) outFile = argv[++i];
+        else if (arg == "--compare" && i + 1 < argc) compareFile = argv[++i];
+        else if (recordFile.empty() && arg[0] != '-') recordFile = arg;
+        else return usage();
+    }
+    if (recordFile.empty()) {
+        return usage();
+    }
+
+    ReplayReader reader;
+    if (!reader.open(recordFile)) {
+        std::cerr << "Not a valid recording: " << recordFile << std::endl;
+        return 1;
+    }
+    std::string mainImage;
+    s_record rec;
+    while (reader.next(rec)) {
+        if (rec.type == REC_IMAGE_LOAD && rec.image.isMain && mainImage.empty()) {
+            mainImage = rec.image.name;
+        }
+        g_records.push_back(rec);
+    }
+    mapSnapshotPages();
+
+    // the command line of the tool: as recorded, without Pin itself and the recording
+    std::vector<std::string> toolArgs;
+    const std::vector<std::string> &recorded = reader.getToolArgs();
+    for (size_t i = 1; i < recorded.size(); i++) {
+        const std::string &arg = recorded[i];
+        if (arg == "-t" || arg == "-record" || (arg == "-o" && outFile.length())) {
+            i++;
+            continue;
+        }
+        toolArgs.push_back(arg);
+    }
+    if (outFile.length()) {
+        toolArgs.push_back("-o");
+        toolArgs.push_back(outFile);
+    }
+    toolArgs.insert(toolArgs.end(), overrides.begin(), overrides.end());
+    if (!hasOption(toolArgs, "--")) {
+        toolArgs.push_back("--");
+        toolArgs.push_back(mainImage.length() ? mainImage : "app");
+    }
+    const std::string toolOutput = getOption(toolArgs, "-o", "output.txt");
+
+    std::vector<char*> toolArgv;
+    toolArgv.push_back(argv[0]);
+    for (size_t i = 0; i < toolArgs.size(); i++) {
+        toolArgv.push_back(const_cast<char*>(toolArgs[i].c_str()));
+    }
+    toolArgv.push_back(NULL);
+
+    shim::setProgram(replayProgram);
+    const int status = TinyTracer_main((int)toolArgv.size() - 1, &toolArgv[0]);
+    if (status != 0) {
+        std::cerr << "The tool failed to start, with the options:";
+        for (size_t i = 0; i < toolArgs.size(); i++) std::cerr << " " << toolArgs[i];
+        std::cerr << std::endl;
+        return status;
+    }
+
+    for (size_t i = 0; i < g_records.size(); i++) {
+        if (g_records[i].type < REC_TYPES_COUNT) g_typeCounts[g_records[i].type]++;
+    }
+    std::cout << "Replayed: " << g_records.size() << " records\n";
+    for (size_t i = REC_NONE + 1; i < REC_TYPES_COUNT; i++) {
+        if (g_typeCounts[i]) std::cout << "  " << g_typeNames[i] << ": " << g_typeCounts[i] << "\n";
+    }
+    if (g_mapFailures) {
+        std::cout << "Pages of the arguments not restored: " << g_mapFailures << "\n";
+    }
+    std::cout << "Time: " << (g_replayNs / 1e6) << " ms";
+    if (g_records.size()) {
+        std::cout << " (" << (g_replayNs / g_records.size()) << " ns/record)";
+    }
+    std::cout << "\nOutput: " << toolOutput << std::endl;
+
+    if (compareFile.length()) {
+        std::string expected, actual;
+        if (!readFile(compareFile, expected) || !readFile(toolOutput, actual)) {
+            std::cerr << "Cannot read the outputs to compare" << std::endl;
+            return 1;
+        }
+        if (expected != actual) {
+            size_t pos = 0;
+            while (pos < expected.size() && pos < actual.size() && expected[pos] == actual[pos]) pos++;
+            std::cout << "DIFFERENT: the outputs differ at the offset: " << pos << std::endl;
+            return 2;
+        }
+        std::cout << "IDENTICAL" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+"""
+End-to-end overhead benchmark of TinyTracer on Linux.
+
+Runs each of the synthetic targets (see: targets/, built by the Makefile) natively, under Pin without a tool,
+and under TinyTracer: with the default options, and with each of the features enabled in turn.
+Then it runs the multi-threaded target with the growing number of threads.
+The report shows the slowdown of each configuration against the native run, and the scaling with the thread count.
+The report (JSON) of the previous run can be given for comparison, to make the regressions visible.
+
+Usage:
+    make && ./run_bench.py --pin $PIN_ROOT/pin --tool ../install_linux/TinyTracer.so
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+
+# target name -> arguments
+TARGETS = [
+    ("call_loop", ["1000000"]),
+    ("rdtsc_storm", ["200000"]),
+    ("section_hop", ["1000000"]),
+    ("jit_shellcode", ["1000000"]),
+    ("thread_hammer", ["4", "1000000"]),
+]
+
+SCALING_TARGET = "thread_hammer"
+SCALING_CALLS = "1000000"
+
+# the default options of the tool, as in install32_64/run_me.bat
+BASE_OPTIONS = ["-f", "1", "-s", "1"]
+
+# feature name -> options added to the default ones; "{watch}" is replaced by the path to the watch list
+FEATURES = [
+    ("rdtsc", ["-d", "1"]),
+    ("watch", ["-b", "{watch}"]),
+    ("syscalls", ["-sys", "1"]),
+    ("callstack", ["-cs", "1"]),
+    ("latency", ["-b", "{watch}", "-lat", "1"]),
+    ("graph", ["-graph", "1"]),
+    ("coverage", ["-cov", "1"]),
+    ("hot", ["-hot", "20"]),
+    ("ngram", ["-ngram", "3"]),
+    ("timeline", ["-timeline", "1"]),
+    ("branches", ["-bt", "1"]),
+    ("taint", ["-b", "{watch}", "-taint", "1"]),
+    ("sample", ["-sample", "10000"]),
+    ("matrix", ["-matrix", "1"]),
+    ("flight", ["-flight", "64"]),
+]
+
+CONFIG_NATIVE = "native"
+CONFIG_NULL = "pin"
+CONFIG_BASE = "tracer"
+
+
+def run_timed(cmd, cwd, timeout):
+    """
+    \return : elapsed seconds, or None if the run failed or timed out
+    """
+    start = time.monotonic()
+    try:
+        proc = subprocess.run(cmd, cwd=cwd, stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL,
+                              stderr=subprocess.DEVNULL, timeout=timeout)
+    except (subprocess.TimeoutExpired, OSError):
+        return None
+    elapsed = time.monotonic() - start
+    if proc.returncode != 0:
+        return None
+    return elapsed
+
+
+def median(values):
+    values = sorted(values)
+    return values[len(values) // 2]
+
+
+class Bench:
+
+    def __init__(self, args):
+        self.args = args
+
+    def make_command(self, config, target_cmd, work_dir):
+        args = self.args
+        if config == CONFIG_NATIVE:
+            return target_cmd
+        if config == CONFIG_NULL:
+            if args.null_tool:
+                return [args.pin, "-t", args.null_tool, "--"] + target_cmd
+            return [args.pin, "--"] + target_cmd
+        options = list(BASE_OPTIONS)
+        for name, feature_options in FEATURES:
+            if name == config:
+                options += [o.replace("{watch}", args.watch) for o in feature_options]
+        tag_file = os.path.join(work_dir, os.path.basename(target_cmd[0]) + ".tag")
+        return [args.pin, "-t", args.tool, "-o", tag_file] + options + ["--"] + target_cmd
+
+    def measure(self, config, target_cmd):
+        """
+        Runs the target in the given configuration (repeatedly), and returns the median time.
+        The outputs of the tool are removed after each run.
+        """
+        times = []
+        for _ in range(self.args.reps):
+            work_dir = tempfile.mkdtemp(prefix="tt_bench_")
+            try:
+                elapsed = run_timed(self.make_command(config, target_cmd, work_dir), work_dir, self.args.timeout)
+            finally:
+                shutil.rmtree(work_dir, ignore_errors=True)
+            if elapsed is None:
+                return None
+            times.append(elapsed)
+        return median(times)
+
+
+def target_path(name):
+    return os.path.join(BENCH_DIR, "bin", name)
+
+
+def format_cell(value, native, previous):
+    if value is None:
+        return "failed"
+    if not native:
+        return "%.3fs" % value
+    cell = "x%.1f" % (value / native)
+    if previous:
+        cell += " (%+.0f%%)" % ((value - previous) * 100.0 / previous)
+    return cell
+
+
+def print_table(title, header, rows, out):
+    widths = [max(len(str(r[i])) for r in [header] + rows) for i in range(len(header))]
+    out.write("\n%s\n" % title)
+    for row in [header, ["-" * w for w in widths]] + rows:
+        out.write("  ".join(str(c).ljust(w) for c, w in zip(row, widths)).rstrip() + "\n")
+
+
+def make_report(report, previous, out):
+    targets = [t for t in report["targets"]]
+    prev_times = previous.get("times", {}) if previous else {}
+
+    header = ["config"] + targets
+    rows = []
+    for config in report["configs"]:
+        row = [config]
+        for target in targets:
+            times = report["times"][target]
+            native = times.get(CONFIG_NATIVE)
+            prev = prev_times.get(target, {}).get(config)
+            if config == CONFIG_NATIVE:
+                row.append(format_cell(times.get(config), None, None))
+            else:
+                row.append(format_cell(times.get(config), native, prev))
+        rows.append(row)
+    print_table("Slowdown against the native run (change against the previous report):", header, rows, out)
+
+    scaling = report.get("scaling")
+    if scaling:
+        prev_scaling = previous.get("scaling", {}) if previous else {}
+        header = ["threads", CONFIG_NATIVE, CONFIG_NULL, CONFIG_BASE]
+        rows = []
+        for threads in sorted(scaling, key=int):
+            times = scaling[threads]
+            native = times.get(CONFIG_NATIVE)
+            prev = prev_scaling.get(threads, {})
+            rows.append([threads, format_cell(native, None, None),
+                         format_cell(times.get(CONFIG_NULL), native, prev.get(CONFIG_NULL)),
+                         format_cell(times.get(CONFIG_BASE), native, prev.get(CONFIG_BASE))])
+        print_table("Scaling with the thread count (%s, %s calls in total):" % (SCALING_TARGET, SCALING_CALLS), header, rows, out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure the overhead of TinyTracer on the synthetic targets.")
+    parser.add_argument("--pin", default=os.path.join(os.environ.get("PIN_ROOT", "/opt/pin"), "pin"), help="Path to the Pin launcher")
+    parser.add_argument("--tool", default=os.path.join(BENCH_DIR, "..", "install_linux", "TinyTracer.so"), help="Path to the TinyTracer tool")
+    parser.add_argument("--null_tool", help="Tool doing nothing, used as the reference for Pin itself (default: Pin without a tool)")
+    parser.add_argument("--watch", default=os.path.join(BENCH_DIR, "params.txt"), help="Watch list used by the features that need it")
+    parser.add_argument("--targets", help="Only the given targets, i.e. call_loop,section_hop")
+    parser.add_argument("--features", help="Only the given features, i.e. syscalls,callstack (default: all)")
+    parser.add_argument("--threads", default="1,2,4,8", help="Thread counts for the scaling test (empty: skip the test)")
+    parser.add_argument("-r", "--reps", type=int, default=3, help="Repetitions of each run (the median is reported)")
+    parser.add_argument("-t", "--timeout", type=float, default=600, help="Timeout per run, in seconds")
+    parser.add_argument("-o", "--out", default="bench_report.json", help="Report file (JSON); the table is saved along with it as .txt")
+    parser.add_argument("--compare", help="Previous report (JSON) to compare with")
+    args = parser.parse_args()
+
+    args.pin = os.path.abspath(args.pin)
+    args.tool = os.path.abspath(args.tool)
+    args.watch = os.path.abspath(args.watch)
+    if args.null_tool:
+        args.null_tool = os.path.abspath(args.null_tool)
+
+    targets = TARGETS
+    if args.targets:
+        selected = args.targets.split(",")
+        targets = [t for t in TARGETS if t[0] in selected]
+    for name, _ in targets:
+        if not os.path.isfile(target_path(name)):
+            parser.error("target not built: %s (run make)" % name)
+
+    features = [f[0] for f in FEATURES]
+    if args.features:
+        selected = args.features.split(",")
+        features = [f for f in features if f in selected]
+    configs = [CONFIG_NATIVE, CONFIG_NULL, CONFIG_BASE] + features
+
+    bench = Bench(args)
+    report = {
+        "date": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "pin": args.pin,
+        "tool": args.tool,
+        "reps": args.reps,
+        "targets": [t[0] for t in targets],
+        "configs": configs,
+        "times": {},
+    }
+    for name, target_args in targets:
+        times = {}
+        for config in configs:
+            times[config] = bench.measure(config, [target_path(name)] + target_args)
+            print("%s [%s]: %s" % (name, config, "failed" if times[config] is None else "%.3fs" % times[config]))
+        report["times"][name] = times
+
+    thread_counts = [t for t in args.threads.split(",") if t]
+    if thread_counts:
+        report["scaling"] = {}
+        for threads in thread_counts:
+            times = {}
+            for config in (CONFIG_NATIVE, CONFIG_NULL, CONFIG_BASE):
+                times[config] = bench.measure(config, [target_path(SCALING_TARGET), threads, SCALING_CALLS])
+            print("%s x%s: %s" % (SCALING_TARGET, threads, times))
+            report["scaling"][threads] = times
+
+    previous = None
+    if args.compare:
+        with open(args.compare, "r") as f:
+            previous = json.load(f)
+
+    with open(args.out, "w") as f:
+        json.dump(report, f, indent=2)
+    with open(os.path.splitext(args.out)[0] + ".txt", "w") as f:
+        make_report(report, previous, f)
+    make_report(report, previous, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Reads the count given as the argument, or returns the default. */
+static long bench_arg(int argc, char *argv[], int index, long defaultVal)
+{
+    if (argc > index) {
+        long val = strtol(argv[index], NULL, 0);
+        if (val > 0) return val;
+    }
+    return defaultVal;
+}
+
+/* Prints the result, so that the compiler cannot drop the benchmarked loop. */
+static int bench_done(const char *name, unsigned long long result)
+{
+    printf("%s: %llx\n", name, result);
+    return 0;
+}
@@ -0,0 +1,21 @@
+/*
+    Tight loop of the calls from the main module into libc: stresses the instrumentation of the calls,
+    and the logging of the API calls.
+    Usage: call_loop [iterations]
+*/
+#include <string.h>
+#include "bench_common.h"
+
+int main(int argc, char *argv[])
+{
+    const long iterations = bench_arg(argc, argv, 1, 1000000);
+    /* called through the pointer, so that the calls cannot be inlined */
+    size_t (*volatile pStrlen)(const char*) = strlen;
+    const char *text = "tiny_tracer";
+    unsigned long long sum = 0;
+    long i;
+    for (i = 0; i < iterations; i++) {
+        sum += pStrlen(text + (i & 7));
+    }
+    return bench_done("call_loop", sum);
+}
@@ -0,0 +1,46 @@
+/*
+    Shellcode allocated at runtime, calling libc: stresses the following of the shellcodes (-f).
+    The shellcode is a trampoline jumping to strlen, so the call to the API is made from the shellcode.
+    Usage: jit_shellcode [iterations]
+*/
+#include <string.h>
+#include <sys/mman.h>
+#include "bench_common.h"
+
+typedef size_t (*strlen_func)(const char*);
+
+static strlen_func make_trampoline(void *target)
+{
+    unsigned char *code = (unsigned char*)mmap(NULL, 0x1000, PROT_READ | PROT_WRITE | PROT_EXEC,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        return NULL;
+    }
+    size_t pos = 0;
+#if defined(__x86_64__)
+    code[pos++] = 0x48; code[pos++] = 0xB8; /* mov rax, target */
+#else
+    code[pos++] = 0xB8; /* mov eax, target */
+#endif
+    memcpy(code + pos, &target, sizeof(target));
+    pos += sizeof(target);
+    code[pos++] = 0xFF; code[pos++] = 0xE0; /* jmp [e|r]ax */
+    return (strlen_func)code;
+}
+
+int main(int argc, char *argv[])
+{
+    const long iterations = bench_arg(argc, argv, 1, 1000000);
+    strlen_func shellcode = make_trampoline((void*)strlen);
+    if (!shellcode) {
+        fprintf(stderr, "Could not allocate the shellcode\n");
+        return 1;
+    }
+    const char *text = "tiny_tracer";
+    unsigned long long sum = 0;
+    long i;
+    for (i = 0; i < iterations; i++) {
+        sum += shellcode(text + (i & 7));
+    }
+    return bench_done("jit_shellcode", sum);
+}
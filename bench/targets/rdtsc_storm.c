@@ -0,0 +1,34 @@
+/*
+    Storm of the RDTSC and CPUID instructions: stresses their instrumentation (-d 1),
+    and the bypass of the RDTSC-based checks.
+    Usage: rdtsc_storm [iterations]
+*/
+#include "bench_common.h"
+
+static unsigned long long read_tsc(void)
+{
+    unsigned int lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+static unsigned int read_cpuid(unsigned int leaf)
+{
+    unsigned int a, b, c, d;
+    __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(leaf), "c"(0));
+    return a ^ b ^ c ^ d;
+}
+
+int main(int argc, char *argv[])
+{
+    const long iterations = bench_arg(argc, argv, 1, 200000);
+    unsigned long long sum = 0;
+    long i;
+    for (i = 0; i < iterations; i++) {
+        sum += read_tsc() & 0xff;
+        if ((i & 15) == 0) {
+            sum += read_cpuid((unsigned int)(i & 1));
+        }
+    }
+    return bench_done("rdtsc_storm", sum);
+}
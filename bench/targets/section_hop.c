@@ -0,0 +1,26 @@
+/*
+    Code hopping between the sections of the main module: stresses the tracking of the transitions between the sections.
+    Each function is placed in its own executable section.
+    Usage: section_hop [iterations]
+*/
+#include "bench_common.h"
+
+#define HOP_FUNC(name, sec, op) \
+    __attribute__((noinline, section(sec))) \
+    static unsigned long long name(unsigned long long x) { return op; }
+
+HOP_FUNC(hop_a, ".hop_a", x * 3 + 1)
+HOP_FUNC(hop_b, ".hop_b", x ^ (x >> 7))
+HOP_FUNC(hop_c, ".hop_c", x + 0x9e3779b9)
+HOP_FUNC(hop_d, ".hop_d", (x << 1) | (x >> 63))
+
+int main(int argc, char *argv[])
+{
+    const long iterations = bench_arg(argc, argv, 1, 1000000);
+    unsigned long long x = 1;
+    long i;
+    for (i = 0; i < iterations; i++) {
+        x = hop_d(hop_c(hop_b(hop_a(x))));
+    }
+    return bench_done("section_hop", x);
+}
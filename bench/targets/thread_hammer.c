@@ -0,0 +1,56 @@
+/*
+    Many threads calling the APIs at the same time: stresses the per-thread state and the shared outputs.
+    The total number of the calls is split between the threads, so that the ideal time does not depend on the thread count.
+    Usage: thread_hammer [threads] [total_calls]
+*/
+#include <pthread.h>
+#include <string.h>
+#include "bench_common.h"
+
+#define MAX_THREADS 256
+
+struct worker_arg {
+    long calls;
+    unsigned long long result;
+};
+
+static void* worker(void *param)
+{
+    struct worker_arg *arg = (struct worker_arg*)param;
+    size_t (*volatile pStrlen)(const char*) = strlen;
+    const char *text = "tiny_tracer";
+    unsigned long long sum = 0;
+    long i;
+    for (i = 0; i < arg->calls; i++) {
+        sum += pStrlen(text + (i & 7));
+    }
+    arg->result = sum;
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    long threads = bench_arg(argc, argv, 1, 4);
+    const long totalCalls = bench_arg(argc, argv, 2, 1000000);
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+    pthread_t handles[MAX_THREADS];
+    struct worker_arg args[MAX_THREADS];
+    long i;
+    for (i = 0; i < threads; i++) {
+        args[i].calls = totalCalls / threads;
+        args[i].result = 0;
+        if (pthread_create(&handles[i], NULL, worker, &args[i]) != 0) {
+            fprintf(stderr, "Could not create the thread: %ld\n", i);
+            threads = i;
+            break;
+        }
+    }
+    unsigned long long sum = 0;
+    for (i = 0; i < threads; i++) {
+        pthread_join(handles[i], NULL);
+        sum += args[i].result;
+    }
+    return bench_done("thread_hammer", sum);
+}
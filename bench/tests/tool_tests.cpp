@@ -0,0 +1,251 @@
+/*
+    Regression tests of the parts of the tool that can run without Pin, built against the thin Pin stand-in (see: bench/pin_shim).
+    Each test writes its output into a temporary file, and checks the produced lines.
+    Usage: tool_tests [name_filter]
+*/
+#include "pin.H"
+
+#include <unistd.h>
+
+#include "../../TraceLog.h"
+#include "../../ModuleMatrix.h"
+#include "../../LiveStatus.h"
+
+namespace {
+
+    size_t g_failures = 0;
+
+    typedef bool (*test_func)(const std::string &outFile);
+
+    struct s_test {
+        const char* name;
+        test_func func;
+    };
+
+    std::vector<std::string> readLines(const std::string &fileName)
+    {
+        std::vector<std::string> lines;
+        std::ifstream file(fileName.c_str());
+        std::string line;
+        while (std::getline(file, line)) {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    bool expectLines(const std::string &fileName, const std::vector<std::string> &expected)
+    {
+        const std::vector<std::string> lines = readLines(fileName);
+        bool isOk = (lines.size() == expected.size());
+        for (size_t i = 0; i < lines.size() && i < expected.size(); i++) {
+            if (lines[i] != expected[i]) {
+                isOk = false;
+                std::cerr << "  line " << i << ": \"" << lines[i] << "\", expected: \"" << expected[i] << "\"" << std::endl;
+            }
+        }
+        if (lines.size() != expected.size()) {
+            std::cerr << "  lines: " << lines.size() << ", expected: " << expected.size() << std::endl;
+        }
+        return isOk;
+    }
+
+    //---
+
+    // the decimal depth must not leak into the addresses logged after it
+    bool testDepthThenShellcodeCall(const std::string &outFile)
+    {
+        {
+            TraceLog log;
+            log.init(outFile, true);
+            log.logCall(0, 0x1010, true, "C:\\Windows\\kernel32.dll", "ReadFile", 12);
+            log.logCall(0x7ff0000, 0x7ff0010, false, "C:\\Windows\\kernel32.dll", "WriteFile");
+            log.logCall(0x7ff0000, 0x20, 0x7fe0000, 0x7fe0030, 13);
+            log.logRdtsc(0x7ff0000, 0x40);
+        }
+        std::vector<std::string> expected;
+        expected.push_back("1010;kernel32.ReadFile [depth=12]");
+        expected.push_back("> 7ff0000+10;kernel32.WriteFile");
+        expected.push_back("> 7ff0000+20;called: ?? [7fe0000+30] [depth=13]");
+        expected.push_back("> 7ff0000+40;RDTSC");
+        return expectLines(outFile, expected);
+    }
+
+    TraceLog* g_pendingLog = NULL;
+    size_t g_pendingCount = 0; // the accesses buffered by the thread
+
+    void flushPending(const THREADID tid)
+    {
+        for (; g_pendingCount > 0; g_pendingCount--) {
+            g_pendingLog->logMemAccess(0, 0x1100, true, 0x5000 + g_pendingCount, 4, 2);
+        }
+    }
+
+    // the buffered accesses must be written before the next event, and must not change its format
+    bool testPendingBeforeEvent(const std::string &outFile)
+    {
+        {
+            TraceLog log;
+            log.init(outFile, true);
+            log.setPendingFlush(flushPending);
+            g_pendingLog = &log;
+            g_pendingCount = 1;
+            log.logSectionChange(0, 0x1000, ".text");
+            g_pendingCount = 2;
+            log.logCall(0x7ff0000, 0x7ff0010, false, "C:\\Windows\\kernel32.dll", "WriteFile");
+            log.logRdtsc(0, 0x1200);
+            g_pendingLog = NULL;
+        }
+        std::vector<std::string> expected;
+        expected.push_back("1100;mem W: 5001 [size=4] [count=2]");
+        expected.push_back("1000;section: [.text]");
+        expected.push_back("1100;mem W: 5002 [size=4] [count=2]");
+        expected.push_back("1100;mem W: 5001 [size=4] [count=2]");
+        expected.push_back("> 7ff0000+10;kernel32.WriteFile");
+        expected.push_back("1200;RDTSC");
+        return expectLines(outFile, expected);
+    }
+
+    std::string callerName(const ADDRINT base, const ADDRINT rva, const bool withSection)
+    {
+        if (base) return "[shellcode]";
+        if (!withSection) return "[main]";
+        return (rva < 0x2000) ? "[main]:.text" : "[main]:.data";
+    }
+
+    // the reference run, and the repacked sample: different paths and RVAs of the same calls
+    void logBaselineRun(const std::string &outFile, EventBaseline &baseline, const bool isSample)
+    {
+        TraceLog log;
+        log.init(outFile, false);
+        log.setBaseline(&baseline, callerName);
+        const ADDRINT shift = isSample ? 0x3000 : 0;
+        log.logSectionChange(0, 0x1000 + shift, ".text");
+        log.logCall(0, 0x1010 + shift, true, isSample ? "C:\\Windows\\SysWOW64\\KERNEL32.DLL" : "C:\\Windows\\System32\\kernel32.dll", "ReadFile", 3);
+        log.logFunctionArgs("\tArg[0] = 1\n\tArg[1] = 2\n");
+        log.logCall(0, 0x1020 + shift, true, "C:\\Windows\\System32\\kernel32.dll", "CreateFileA");
+        log.logFunctionArgs(isSample ? "\tArg[0] = \"b.txt\"\n" : "\tArg[0] = \"a.txt\"\n");
+        log.logCall(0, 0x1030 + shift, true, "C:\\Windows\\System32\\kernel32.dll", isSample ? "VirtualAlloc" : "GetTickCount");
+    }
+
+    bool testBaseline(const std::string &outFile, const bool withRva, std::vector<std::string> &expected)
+    {
+        const std::string baselineFile = outFile + ".bl";
+        {
+            EventBaseline reference;
+            reference.setWithRva(withRva);
+            reference.enableCollecting();
+            logBaselineRun(outFile, reference, false);
+            if (!reference.save(baselineFile)) return false;
+        }
+        EventBaseline baseline;
+        const bool isLoaded = baseline.load(baselineFile);
+        ::unlink(baselineFile.c_str());
+        if (!isLoaded || baseline.isWithRva() != withRva) return false;
+        logBaselineRun(outFile, baseline, true);
+        return expectLines(outFile, expected);
+    }
+
+    // the noise is matched by the short names, despite the different paths and RVAs; the section changes and the new arguments are kept
+    bool testBaselineRepacked(const std::string &outFile)
+    {
+        std::vector<std::string> expected;
+        expected.push_back("4000;section: [.text]");
+        expected.push_back("4020;called: C:\\Windows\\System32\\kernel32.dll.CreateFileA");
+        expected.push_back("\tArg[0] = \"b.txt\"");
+        expected.push_back("4030;called: C:\\Windows\\System32\\kernel32.dll.VirtualAlloc");
+        return testBaseline(outFile, false, expected);
+    }
+
+    // matching by the RVA: only the same call sites are skipped
+    bool testBaselineWithRva(const std::string &outFile)
+    {
+        std::vector<std::string> expected;
+        expected.push_back("4000;section: [.text]");
+        expected.push_back("4010;called: C:\\Windows\\SysWOW64\\KERNEL32.DLL.ReadFile [depth=3]");
+        expected.push_back("\tArg[0] = 1");
+        expected.push_back("\tArg[1] = 2");
+        expected.push_back("4020;called: C:\\Windows\\System32\\kernel32.dll.CreateFileA");
+        expected.push_back("\tArg[0] = \"b.txt\"");
+        expected.push_back("4030;called: C:\\Windows\\System32\\kernel32.dll.VirtualAlloc");
+        return testBaseline(outFile, true, expected);
+    }
+
+    // a module loaded again keeps its id, the ones above the limit are reported
+    bool testModuleIdsReload(const std::string &outFile)
+    {
+        ModuleIds ids;
+        const UINT16 first = ids.addModule(0x10000, 0x20000, "C:\\Windows\\System32\\a.dll");
+        ids.removeModule(0x10000);
+        const UINT16 reloaded = ids.addModule(0x30000, 0x40000, "C:\\Windows\\System32\\a.dll");
+        bool isOk = (first == reloaded) && (ids.count() == 2) && (ids.findId(0x30010) == first) && (ids.findId(0x10010) == MODULE_ID_UNKNOWN);
+
+        for (ADDRINT i = 0; ids.count() < MODULE_IDS_MAX; i++) {
+            std::stringstream name;
+            name << "m" << i << ".dll";
+            ids.addModule(0x100000 + i * 0x1000, 0x100000 + (i + 1) * 0x1000, name.str());
+        }
+        isOk = isOk && (ids.countOverLimit() == 0);
+        const UINT16 over = ids.addModule(0x8000000, 0x8001000, "over.dll");
+        isOk = isOk && (over == MODULE_ID_UNKNOWN) && (ids.countOverLimit() == 1) && (ids.findId(0x8000010) == MODULE_ID_UNKNOWN);
+
+        TransitionMatrix matrix;
+        matrix.add(first, 2);
+        isOk = isOk && matrix.write(outFile, ids);
+        const std::vector<std::string> lines = readLines(outFile);
+        isOk = isOk && lines.size() > 1 && lines[1] == "# modules over the limit, counted as 0: 1";
+        return isOk;
+    }
+
+    // each update leaves its sequence counter even, so that the reader accepts the fields
+    bool testLiveStatusSequence(const std::string &outFile)
+    {
+        LiveStatus status;
+        if (!status.init(outFile)) return false;
+        status.setThreadAlive(1, true);
+        for (size_t i = 0; i < 3; i++) {
+            status.addWrite(1, 10);
+        }
+        status.setSection(1, ".text");
+        status.addDropped(2);
+        status.close();
+
+        s_live_status copy;
+        std::ifstream file(outFile.c_str(), std::ios::binary);
+        if (!file.read(reinterpret_cast<char*>(&copy), sizeof(copy))) return false;
+
+        const s_live_header &h = copy.header;
+        const s_live_thread &t = copy.threads[1];
+        return h.version == LIVE_STATUS_VERSION && h.sequence == 8 && h.eventsLogged == 3 && h.bytesWritten == 30 && h.eventsDropped == 2
+            && t.sequence == 8 && t.events == 3 && std::string(t.section) == ".text";
+    }
+
+    const s_test g_tests[] = {
+        { "depth_then_shellcode_call", testDepthThenShellcodeCall },
+        { "pending_before_event", testPendingBeforeEvent },
+        { "baseline_repacked", testBaselineRepacked },
+        { "baseline_with_rva", testBaselineWithRva },
+        { "module_ids_reload", testModuleIdsReload },
+        { "live_status_sequence", testLiveStatusSequence },
+    };
+};
+
+int main(int argc, char *argv[])
+{
+    const std::string filter = (argc > 1) ? argv[1] : "";
+    std::stringstream ss;
+    ss << "/tmp/tool_tests_" << ::getpid() << ".txt";
+    const std::string outFile = ss.str();
+
+    size_t count = 0;
+    for (size_t i = 0; i < sizeof(g_tests) / sizeof(g_tests[0]); i++) {
+        const s_test &test = g_tests[i];
+        if (filter.length() && std::string(test.name).find(filter) == std::string::npos) continue;
+        count++;
+        const bool isOk = test.func(outFile);
+        std::cout << (isOk ? "[OK]   " : "[FAIL] ") << test.name << std::endl;
+        if (!isOk) g_failures++;
+        ::unlink(outFile.c_str());
+    }
+    std::cout << count << " tests, " << g_failures << " failed" << std::endl;
+    return g_failures ? 1 : 0;
+}
@@ -26,6 +26,8 @@ set TRACE_RDTSC=0
 
 rem WATCH_BEFORE - a file with a list of functions which's parameters will be logged before execution
 rem The file must be a list of records in a format: [dll_name];[func_name];[parameters_count]
+rem Optionally, the values to be logged after the function returns can be added: [dll_name];[func_name];[parameters_count];[r][,o<arg_idx>[:<size>]]
+rem   r - the return value; o<arg_idx> - the out-parameter, with the size in bytes, or: *<arg_idx> - stored under the pointer in the given argument, #<arg_idx> - given by the argument
 set WATCH_BEFORE=%PIN_TOOLS_DIR%\params.txt
 
 set DLL_LOAD32=%PIN_TOOLS_DIR%\dll_load32.exe
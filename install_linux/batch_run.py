@@ -0,0 +1,451 @@
+#!/usr/bin/env python3
+"""
+Batch runner for TinyTracer on Linux.
+
+Traces a set of samples (a directory, a list of files, or a queue file) with N concurrent Pin instances,
+each pinned to its own core. Every sample gets its own output directory, and a timeout.
+The outputs and the exit codes are collected into one result manifest (JSON),
+along with the throughput (samples per hour) and the per-sample overhead.
+Optionally, the results are kept in a content-addressed cache, so that a sample that was already traced
+with the same tool and options is not traced again.
+
+Usage:
+    batch_run.py [options] <targets...> [-- <extra TinyTracer options>]
+i.e.
+    batch_run.py -j 8 -t 120 --native -o results/ samples/ -- -sys 1 -cs 1
+"""
+
+import argparse
+import hashlib
+import json
+import os
+import queue
+import shutil
+import signal
+import subprocess
+import sys
+import threading
+import time
+
+MANIFEST_NAME = "manifest.json"
+MANIFEST_VERSION = 1
+
+STATUS_OK = "ok"
+STATUS_TIMEOUT = "timeout"
+STATUS_ERROR = "error"
+
+CACHE_RESULT_NAME = "result.json"
+CACHE_HIT = "hit"
+CACHE_MISS = "miss"
+# the fields of the record that do not depend on the location of the outputs
+CACHED_FIELDS = ("exit_code", "status", "traced_time", "native_time", "native_exit_code", "overhead")
+
+TASKSET = shutil.which("taskset")
+
+
+def file_sha256(path):
+    h = hashlib.sha256()
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(0x100000), b""):
+            h.update(chunk)
+    return h.hexdigest()
+
+
+def collect_targets(paths, queue_file):
+    """
+    Collects the samples to be traced: the given files, the executable files from the given directories (recursively),
+    and the paths listed in the queue file (one per line, '-' for stdin).
+    """
+    targets = []
+    for path in paths:
+        if os.path.isdir(path):
+            for root, dirs, files in os.walk(path):
+                dirs.sort()
+                for name in sorted(files):
+                    full = os.path.join(root, name)
+                    if os.access(full, os.X_OK):
+                        targets.append(full)
+        elif os.path.isfile(path):
+            targets.append(path)
+        else:
+            print("[WARNING] Target not found: %s" % path, file=sys.stderr)
+    if queue_file:
+        stream = sys.stdin if queue_file == "-" else open(queue_file, "r")
+        try:
+            for line in stream:
+                line = line.strip()
+                if line and not line.startswith("#"):
+                    targets.append(line)
+        finally:
+            if stream is not sys.stdin:
+                stream.close()
+    return [os.path.abspath(t) for t in targets]
+
+
+def parse_cores(spec):
+    """
+    Parses the list of the cores, i.e. "0-3,6". If not given, all the cores available to this process are used.
+    """
+    if not spec:
+        return sorted(os.sched_getaffinity(0))
+    cores = []
+    for item in spec.split(","):
+        item = item.strip()
+        if not item:
+            continue
+        if "-" in item:
+            start, end = item.split("-", 1)
+            cores.extend(range(int(start), int(end) + 1))
+        else:
+            cores.append(int(item))
+    return cores
+
+
+def build_tool_args(args, tag_file):
+    """
+    Builds the options of the tool: the same defaults as in install32_64/run_me.bat, followed by the extra options.
+    """
+    tool_args = ["-o", tag_file,
+                 "-f", str(args.follow_shellcodes),
+                 "-d", str(args.trace_rdtsc),
+                 "-s", str(args.short_log)]
+    if args.module:
+        tool_args += ["-m", args.module]
+    if args.watch:
+        tool_args += ["-b", os.path.abspath(args.watch)]
+    return tool_args + args.extra
+
+
+def run_pinned(cmd, core, timeout, cwd, stdout, stderr):
+    """
+    Runs the command pinned to the given core, and kills the whole process group if it does not finish in time.
+    \return : (exit code, elapsed seconds, is timeout)
+    """
+    # the affinity is set by taskset before the exec, so that all the threads of Pin inherit it
+    # (preexec_fn is not safe to use from the worker threads)
+    if core is not None and TASKSET:
+        cmd = [TASKSET, "-c", str(core)] + cmd
+
+    start = time.monotonic()
+    proc = subprocess.Popen(cmd, cwd=cwd, stdin=subprocess.DEVNULL, stdout=stdout, stderr=stderr,
+                            start_new_session=True)
+    if core is not None and not TASKSET:
+        # no taskset: pinned right after the spawn, the threads started before may stay unpinned
+        try:
+            os.sched_setaffinity(proc.pid, {core})
+        except OSError:
+            pass
+    is_timeout = False
+    try:
+        proc.wait(timeout=timeout)
+    except subprocess.TimeoutExpired:
+        is_timeout = True
+        try:
+            os.killpg(proc.pid, signal.SIGKILL)
+        except ProcessLookupError:
+            pass
+        proc.wait()
+    return proc.returncode, time.monotonic() - start, is_timeout
+
+
+def find_trace_error(tag_file, code, stderr_file):
+    """
+    Checks if the run that finished in time actually produced the trace.
+    \return : the description of the error, or None if the trace is complete
+    """
+    # Pin reports its own failures (i.e. the tool could not be loaded) in the lines starting with "E:"
+    try:
+        with open(stderr_file, "rb") as f:
+            for line in f:
+                if line.startswith(b"E:"):
+                    return "Pin failed: " + line.decode("utf-8", "replace").strip()
+    except OSError:
+        pass
+    if code is not None and code < 0:
+        return "killed by the signal: %d" % -code
+    if not os.path.isfile(tag_file) or os.path.getsize(tag_file) == 0:
+        return "no trace produced (exit code: %s)" % code
+    return None
+
+
+def make_cache_base(args):
+    """
+    Hashes everything that the result depends on, apart from the sample itself: the tool, the watch list, and the options.
+    The extra options that are paths to the existing files (i.e. the baseline) are hashed by their content.
+    """
+    h = hashlib.sha256()
+    h.update(file_sha256(args.tool).encode() if os.path.isfile(args.tool) else args.tool.encode())
+    h.update(b"\0")
+    h.update(file_sha256(args.watch).encode() if args.watch else b"")
+    watch_path = os.path.abspath(args.watch) if args.watch else None
+    for arg in build_tool_args(args, ""):
+        h.update(b"\0")
+        if arg == watch_path:
+            continue # already hashed by the content
+        h.update(file_sha256(arg).encode() if os.path.isfile(arg) else arg.encode())
+    return h.hexdigest()
+
+
+def make_cache_key(args, target, digest):
+    """
+    The key of the result: the sample is identified by its hash, and by its name (by default, the traced module is selected by the name).
+    """
+    h = hashlib.sha256()
+    h.update(args.cache_base.encode())
+    h.update(b"\0" + digest.encode())
+    h.update(b"\0" + os.path.basename(target).encode())
+    return h.hexdigest()
+
+
+def cache_dir_for(args, key):
+    return os.path.join(args.cache, key[:2], key)
+
+
+def cache_load(args, key, out_dir):
+    """
+    Copies the cached outputs into the output directory.
+    \return : the cached fields of the record, or None if there is no complete result for this key
+    """
+    entry = cache_dir_for(args, key)
+    try:
+        with open(os.path.join(entry, CACHE_RESULT_NAME), "r") as f:
+            cached = json.load(f)
+    except (OSError, ValueError):
+        return None
+    for name in os.listdir(entry):
+        if name != CACHE_RESULT_NAME:
+            shutil.copy2(os.path.join(entry, name), os.path.join(out_dir, name))
+    return cached
+
+
+def cache_store(args, key, out_dir, record):
+    """
+    Stores the outputs along with the record. The entry is filled in a temporary directory and renamed at the end,
+    so that an interrupted run never leaves an incomplete result.
+    """
+    entry = cache_dir_for(args, key)
+    if os.path.isdir(entry):
+        return
+    tmp = "%s.tmp.%d.%d" % (entry, os.getpid(), threading.get_ident())
+    try:
+        shutil.copytree(out_dir, tmp)
+        with open(os.path.join(tmp, CACHE_RESULT_NAME), "w") as f:
+            json.dump(dict((k, record[k]) for k in CACHED_FIELDS if k in record), f)
+        os.rename(tmp, entry)
+    except OSError:
+        # i.e. the same sample was stored in the meantime by another worker
+        shutil.rmtree(tmp, ignore_errors=True)
+
+
+def sample_out_dir(args, index, target, digest):
+    # the index in the queue: the same sample may be queued more than once
+    name = os.path.basename(target)
+    return os.path.join(args.out_dir, "%d_%s_%s" % (index, name, digest[:12]))
+
+
+def trace_sample(args, index, target, core):
+    """
+    Traces a single sample, and returns its record for the manifest.
+    """
+    record = {"target": target, "core": core}
+    try:
+        digest = file_sha256(target)
+    except OSError as e:
+        record.update({"status": STATUS_ERROR, "error": str(e)})
+        return record
+
+    out_dir = sample_out_dir(args, index, target, digest)
+    if os.path.isdir(out_dir):
+        shutil.rmtree(out_dir)
+    os.makedirs(out_dir)
+
+    key = None
+    if args.cache:
+        key = make_cache_key(args, target, digest)
+        cached = cache_load(args, key, out_dir)
+        if cached is not None:
+            record.update({"sha256": digest, "out_dir": out_dir, "cache": CACHE_HIT, "cache_key": key})
+            record.update(cached)
+            record["outputs"] = sorted(os.listdir(out_dir))
+            return record
+
+    tag_file = os.path.join(out_dir, os.path.basename(target) + ".tag")
+    cmd = [args.pin, "-t", args.tool] + build_tool_args(args, tag_file) + ["--", target]
+
+    stderr_file = os.path.join(out_dir, "stderr.txt")
+    try:
+        with open(os.path.join(out_dir, "stdout.txt"), "wb") as out, open(stderr_file, "wb") as err:
+            code, elapsed, is_timeout = run_pinned(cmd, core, args.timeout, out_dir, out, err)
+    except OSError as e:
+        record.update({"sha256": digest, "command": cmd, "out_dir": out_dir, "status": STATUS_ERROR, "error": str(e)})
+        return record
+
+    record.update({
+        "sha256": digest,
+        "command": cmd,
+        "out_dir": out_dir,
+        "exit_code": code,
+        "status": STATUS_TIMEOUT if is_timeout else STATUS_OK,
+        "traced_time": round(elapsed, 3),
+    })
+    if not is_timeout:
+        error = find_trace_error(tag_file, code, stderr_file)
+        if error:
+            record.update({"status": STATUS_ERROR, "error": error})
+
+    if args.native:
+        # the same sample without the instrumentation: the reference for the overhead
+        with open(os.devnull, "wb") as null:
+            native_code, native_elapsed, native_timeout = run_pinned([target], core, args.timeout, out_dir, null, null)
+        record["native_time"] = round(native_elapsed, 3)
+        record["native_exit_code"] = native_code
+        if native_elapsed > 0 and not native_timeout and not is_timeout:
+            record["overhead"] = round(elapsed / native_elapsed, 2)
+
+    record["outputs"] = sorted(os.listdir(out_dir))
+    if key:
+        record["cache"] = CACHE_MISS
+        record["cache_key"] = key
+        # only the complete results are kept: the timed out or failed ones may succeed next time
+        if record["status"] == STATUS_OK:
+            cache_store(args, key, out_dir, record)
+    return record
+
+
+def make_summary(records, total_time, workers):
+    summary = {"samples": len(records), "workers": workers, "total_time": round(total_time, 3)}
+    for status in (STATUS_OK, STATUS_TIMEOUT, STATUS_ERROR):
+        summary[status] = sum(1 for r in records if r.get("status") == status)
+
+    summary["samples_per_hour"] = round(len(records) * 3600.0 / total_time, 1) if total_time > 0 else 0
+
+    hits = sum(1 for r in records if r.get("cache") == CACHE_HIT)
+    misses = sum(1 for r in records if r.get("cache") == CACHE_MISS)
+    if hits + misses:
+        summary["cache_hits"] = hits
+        summary["cache_misses"] = misses
+        summary["cache_hit_rate"] = round(float(hits) / (hits + misses), 3)
+
+    # the times of the cached results do not reflect this run
+    traced = [r["traced_time"] for r in records if "traced_time" in r and r.get("cache") != CACHE_HIT]
+    if traced:
+        summary["mean_traced_time"] = round(sum(traced) / len(traced), 3)
+    overheads = sorted(r["overhead"] for r in records if "overhead" in r and r.get("cache") != CACHE_HIT)
+    if overheads:
+        summary["mean_overhead"] = round(sum(overheads) / len(overheads), 2)
+        summary["median_overhead"] = overheads[len(overheads) // 2]
+    return summary
+
+
+def run_batch(args, targets, cores):
+    """
+    Distributes the samples among the workers: each worker owns one core, and takes the next sample from the queue.
+    """
+    pending = queue.Queue()
+    for index, target in enumerate(targets):
+        pending.put((index, target))
+
+    records = [None] * len(targets)
+    lock = threading.Lock()
+    done = [0]
+
+    def worker(core):
+        while True:
+            try:
+                index, target = pending.get_nowait()
+            except queue.Empty:
+                return
+            record = trace_sample(args, index, target, core)
+            records[index] = record
+            with lock:
+                done[0] += 1
+                print("[%d/%d] %s: %s (%.1fs)" % (done[0], len(targets), record.get("status"), target,
+                                                  record.get("traced_time", 0)))
+
+    threads = [threading.Thread(target=worker, args=(core,)) for core in cores]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    return records
+
+
+def main():
+    argv = sys.argv[1:]
+    extra = []
+    if "--" in argv:
+        sep = argv.index("--")
+        argv, extra = argv[:sep], argv[sep + 1:]
+
+    parser = argparse.ArgumentParser(description="Trace a batch of samples with TinyTracer, using concurrent Pin instances.")
+    parser.add_argument("targets", nargs="*", help="Samples to be traced: files or directories")
+    parser.add_argument("-q", "--queue", help="File with the list of the samples, one per line ('-' for stdin)")
+    parser.add_argument("-o", "--out_dir", default="tiny_tracer_out", help="Directory for the outputs and the manifest")
+    parser.add_argument("--pin", default=os.path.join(os.environ.get("PIN_ROOT", "/opt/pin"), "pin"), help="Path to the Pin launcher")
+    parser.add_argument("--tool", default=os.path.join(os.path.dirname(os.path.abspath(__file__)), "TinyTracer.so"), help="Path to the TinyTracer tool")
+    parser.add_argument("-j", "--jobs", type=int, default=0, help="Number of concurrent Pin instances (default: one per core)")
+    parser.add_argument("--cores", help="Cores to pin the instances to, i.e. 0-3,6 (default: all the available cores)")
+    parser.add_argument("-t", "--timeout", type=float, default=300, help="Timeout per sample, in seconds")
+    parser.add_argument("--native", action="store_true", help="Run each sample also without Pin, to measure the overhead")
+    parser.add_argument("--cache", help="Directory of the result cache: the samples already traced with the same tool and options are not traced again")
+    parser.add_argument("-m", "--module", help="Traced module (default: the main module of the sample)")
+    parser.add_argument("-b", "--watch", help="Watch list: functions which's parameters will be logged")
+    parser.add_argument("-f", "--follow_shellcodes", type=int, default=1, help="Trace calls executed from shellcodes (as the -f option of the tool)")
+    parser.add_argument("-d", "--trace_rdtsc", type=int, default=0, help="Trace RDTSC")
+    parser.add_argument("-s", "--short_log", type=int, default=1, help="Use short call logging")
+    args = parser.parse_args(argv)
+    args.extra = extra
+
+    targets = collect_targets(args.targets, args.queue)
+    if not targets:
+        parser.error("no targets given")
+
+    cores = parse_cores(args.cores)
+    if not cores:
+        parser.error("no cores available")
+    if args.jobs > 0:
+        # more instances than the cores: the cores are shared in a round-robin
+        cores = [cores[i % len(cores)] for i in range(args.jobs)]
+
+    args.out_dir = os.path.abspath(args.out_dir)
+    args.pin = os.path.abspath(args.pin)
+    args.tool = os.path.abspath(args.tool)
+    os.makedirs(args.out_dir, exist_ok=True)
+    if args.cache:
+        args.cache = os.path.abspath(args.cache)
+        os.makedirs(args.cache, exist_ok=True)
+        args.cache_base = make_cache_base(args)
+
+    start = time.monotonic()
+    records = run_batch(args, targets, cores)
+    total_time = time.monotonic() - start
+
+    manifest = {
+        "version": MANIFEST_VERSION,
+        "started": time.strftime("%Y-%m-%dT%H:%M:%S", time.localtime(time.time() - total_time)),
+        "pin": args.pin,
+        "tool": args.tool,
+        "tool_args": build_tool_args(args, "<out_dir>/<sample>.tag"),
+        "timeout": args.timeout,
+        "cache": args.cache,
+        "summary": make_summary(records, total_time, len(cores)),
+        "samples": records,
+    }
+    manifest_path = os.path.join(args.out_dir, MANIFEST_NAME)
+    with open(manifest_path, "w") as f:
+        json.dump(manifest, f, indent=2)
+
+    summary = manifest["summary"]
+    print("Traced %d samples in %.1fs: %s samples/hour, ok: %d, timeout: %d, error: %d"
+          % (summary["samples"], total_time, summary["samples_per_hour"],
+             summary[STATUS_OK], summary[STATUS_TIMEOUT], summary[STATUS_ERROR]))
+    if "cache_hits" in summary:
+        print("Cache: hits: %d, misses: %d" % (summary["cache_hits"], summary["cache_misses"]))
+    if "mean_overhead" in summary:
+        print("Overhead (traced/native): mean: x%s, median: x%s" % (summary["mean_overhead"], summary["median_overhead"]))
+    print("Manifest: %s" % manifest_path)
+    return 0 if summary[STATUS_ERROR] == 0 else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
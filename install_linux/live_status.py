@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""
+Viewer of the live status of the running TinyTracer (enabled with: -live 1).
+
+Reads the status file (<output>.live), that the tool keeps mapped into its memory, and shows the progress of the trace:
+the events per second, the bytes written, the fill of the buffers, the dropped events, and the current section of each thread.
+The rates are computed between the consecutive reads. Optionally, exits with a distinct code when the trace stalls
+or runs away, so that the orchestrator can kill the sample early.
+
+Usage:
+    live_status.py [options] <status files...>
+i.e.
+    live_status.py -i 5 results/sample_1234/output.txt.live
+    live_status.py --once --json --stall 60 --max-bytes 1000000000 output.txt.live
+"""
+
+import argparse
+import json
+import mmap
+import struct
+import sys
+import time
+
+# keep in sync with LiveStatus.h
+LIVE_STATUS_MAGIC = 0x534c5454
+LIVE_STATUS_VERSION = 2
+HEADER_FORMAT = "<IIIIQQQQQQII"
+THREAD_FORMAT = "<IIQIII36s"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+THREAD_SIZE = struct.calcsize(THREAD_FORMAT)
+# the offsets of the sequence counters, that guard the fields against the torn reads
+HEADER_SEQUENCE_OFFSET = 68
+THREAD_SEQUENCE_OFFSET = 24
+
+READ_RETRIES = 100
+
+EXIT_OK = 0
+EXIT_ERROR = 1
+EXIT_STALLED = 3
+EXIT_RUNAWAY = 4
+
+
+def read_consistent(buf, offset, size, sequence_offset):
+    """
+    Copies the fields guarded by the given sequence counter: retries while they are being updated (the counter is odd),
+    or if they were updated during the copy (the counter changed). Returns None if they keep changing.
+    """
+    for _ in range(READ_RETRIES):
+        (before,) = struct.unpack_from("<I", buf, offset + sequence_offset)
+        data = buf[offset:offset + size]
+        (after,) = struct.unpack_from("<I", buf, offset + sequence_offset)
+        if before == after and not before & 1:
+            return data
+        time.sleep(0)
+    return None
+
+
+def read_status(path):
+    """Returns the status as a dict, or None if the file is not (yet) a valid status."""
+    try:
+        with open(path, "rb") as f:
+            # mapped, not read: the counters are checked right before and after each copy
+            buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    except (OSError, ValueError):
+        return None
+    try:
+        return parse_status(path, buf)
+    finally:
+        buf.close()
+
+
+def parse_status(path, buf):
+    if len(buf) < HEADER_SIZE:
+        return None
+    header = read_consistent(buf, 0, HEADER_SIZE, HEADER_SEQUENCE_OFFSET)
+    if header is None:
+        return None
+    (magic, version, pid, threads_max, logged, filtered, dropped, written,
+     recorder_held, recorder_capacity, is_finished, _) = struct.unpack(HEADER_FORMAT, header)
+    if magic != LIVE_STATUS_MAGIC or version != LIVE_STATUS_VERSION:
+        return None
+    threads = []
+    for i in range(threads_max):
+        offset = HEADER_SIZE + i * THREAD_SIZE
+        if offset + THREAD_SIZE > len(buf):
+            break
+        slot = read_consistent(buf, offset, THREAD_SIZE, THREAD_SEQUENCE_OFFSET)
+        if slot is None:
+            return None
+        tid, is_alive, events, pending, pending_max, _, section = struct.unpack(THREAD_FORMAT, slot)
+        if not is_alive:
+            continue
+        section = section.split(b"\0", 1)[0].decode("ascii", "replace")
+        threads.append({
+            "tid": tid,
+            "events": events,
+            "pending_calls": pending,
+            "pending_max": pending_max,
+            "section": section,
+        })
+    return {
+        "file": path,
+        "pid": pid,
+        "events_logged": logged,
+        "events_filtered": filtered,
+        "events_dropped": dropped,
+        "bytes_written": written,
+        "recorder_held": recorder_held,
+        "recorder_capacity": recorder_capacity,
+        "is_finished": bool(is_finished),
+        "threads": threads,
+    }
+
+
+def add_rates(curr, prev, interval):
+    """Adds the rates per second, computed against the previous read."""
+    for name in ("events_logged", "bytes_written", "events_dropped"):
+        delta = curr[name] - prev[name] if prev else 0
+        curr[name + "_per_sec"] = round(delta / interval, 1) if interval > 0 else 0.0
+
+
+def format_size(value):
+    for unit in ("B", "KB", "MB"):
+        if value < 1024:
+            return "%.1f %s" % (value, unit)
+        value /= 1024.0
+    return "%.1f GB" % value
+
+
+def print_status(status):
+    state = "finished" if status["is_finished"] else "running"
+    print("%s [pid %d, %s]" % (status["file"], status["pid"], state))
+    print("  events: %d logged (%.1f/s), %d filtered, %d dropped (%.1f/s)" % (
+        status["events_logged"], status["events_logged_per_sec"], status["events_filtered"],
+        status["events_dropped"], status["events_dropped_per_sec"]))
+    print("  written: %s (%s/s)" % (format_size(status["bytes_written"]), format_size(status["bytes_written_per_sec"])))
+    if status["recorder_capacity"]:
+        print("  flight recorder: %d/%d records (%.0f%%)" % (
+            status["recorder_held"], status["recorder_capacity"],
+            100.0 * status["recorder_held"] / status["recorder_capacity"]))
+    for thread in status["threads"]:
+        print("  thread %-4d events: %-10d pending calls: %d/%d  section: %s" % (
+            thread["tid"], thread["events"], thread["pending_calls"], thread["pending_max"], thread["section"] or "-"))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Show the live status of the running TinyTracer (-live 1)")
+    parser.add_argument("files", nargs="+", help="the status files: <output>.live")
+    parser.add_argument("-i", "--interval", type=float, default=2.0, help="seconds between the reads (default: 2)")
+    parser.add_argument("--once", action="store_true", help="read twice (to compute the rates), show, and exit")
+    parser.add_argument("--json", action="store_true", help="print the status as JSON (one object per line)")
+    parser.add_argument("--stall", type=float, default=0,
+                        help="exit with %d if no event was logged for the given number of seconds" % EXIT_STALLED)
+    parser.add_argument("--max-bytes", type=int, default=0,
+                        help="exit with %d if the trace wrote more than the given number of bytes" % EXIT_RUNAWAY)
+    args = parser.parse_args()
+
+    prev = {}
+    last_change = {}
+    is_first = True
+    while True:
+        now = time.time()
+        statuses = []
+        for path in args.files:
+            status = read_status(path)
+            if status is None:
+                print("%s: not a valid status file (yet)" % path, file=sys.stderr)
+                if args.once:
+                    return EXIT_ERROR
+                continue
+            old = prev.get(path)
+            add_rates(status, old, args.interval)
+            if not old or old["events_logged"] != status["events_logged"]:
+                last_change[path] = now
+            prev[path] = status
+            statuses.append(status)
+
+        # the first read is only the base for the rates
+        if not is_first:
+            for status in statuses:
+                if args.json:
+                    print(json.dumps(status))
+                else:
+                    print_status(status)
+            sys.stdout.flush()
+
+            for status in statuses:
+                path = status["file"]
+                if args.max_bytes and status["bytes_written"] > args.max_bytes:
+                    print("%s: runaway: %d bytes written" % (path, status["bytes_written"]), file=sys.stderr)
+                    return EXIT_RUNAWAY
+                if args.stall and not status["is_finished"] and now - last_change[path] >= args.stall:
+                    print("%s: stalled: no events for %.0f s" % (path, now - last_change[path]), file=sys.stderr)
+                    return EXIT_STALLED
+            if args.once or (statuses and all(s["is_finished"] for s in statuses)):
+                return EXIT_OK
+        is_first = False
+        time.sleep(args.interval)
+
+
+if __name__ == "__main__":
+    sys.exit(main())